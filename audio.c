@@ -1,271 +1,533 @@
-/*
-* audio.c
-* 
-* loading and playing audio tracks for the game
-*
-*Author: Michael Bossner
-*/
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <stdio.h>
-
-#include "audio.h"
-#include "timer0.h"
-#include "game.h"
-
-////////////////////////////// Global variables ////////////////////////////////
-
-// time between each note with no tone
-#define REST_TIME 50
-
-// Note frequencies for the buzzer
-#define NO_NOTE 0
-#define C 261
-#define D 294
-#define E 329
-#define F 349
-#define G 391
-#define GS 415
-#define A 440
-#define AS 455
-#define B 466
-#define CH 523
-#define CSH 554
-#define DH 587
-#define DSH 622
-#define EH 659
-#define FH 698
-#define FSH 740
-#define GH 784
-#define GSH 830
-#define AH 880
-
-static uint16_t freq;
-static uint16_t clockperiod;
-static float dutycycle;
-static uint16_t pulsewidth;
-static uint32_t tone_start_time;
-static uint32_t rest_start_time;
-static uint8_t rest = FALSE;
-static uint8_t tone = FALSE;
-static uint8_t count = 0;
-static uint8_t is_track_loaded = FALSE;
-static uint16_t *loaded_track;
-static uint16_t *loaded_track_duration;
-static uint8_t array_size;
-static uint16_t tone_duration;
-
-// Unused track
-/*
-static uint16_t track_bgm[74] = {A,A,A,F,CH,A,F,CH,A,NO_NOTE,EH,EH,EH,FH,CH,GS,
-	F,CH,A,NO_NOTE,AH,A,A,AH,GSH,GH,FSH,FH,FSH,NO_NOTE,AS,DSH,DH,CSH,CH,B,CH,
-	NO_NOTE,F,GS,F,A,CH,A,CH,EH,NO_NOTE,AH,A,A,AH,GSH,GH,FSH,FH,FSH,NO_NOTE,AS,
-	DSH,DH,CSH,CH,B,CH,NO_NOTE,F,GS,F,CH,A,F,CH,A,NO_NOTE
-};
-
-static uint16_t track_bgm_duration[74] = {500,500,500,350,150,500,350,150,650,
-	500,500,500,500,350,150,500,350,150,650,500,500,300,150,500,325,175,125,125,
-	250,325,250,500,325,175,125,125,250,350,250,500,350,125,500,375,125,650,500,
-	500,300,150,500,325,175,125,125,250,325,250,500,325,175,125,125,250,350,250,
-	500,375,125,500,375,125,650,650
-};
-*/
-
-// Audio Tracks
-#define TRACK_FROG_JUMP_SIZE 2
-static uint16_t track_frog_jump_tone[2] = {A,C};
-static uint16_t track_frog_jump_duration[2] = {50,25};
-
-#define TRACK_FROG_DIED_SIZE 5
-static uint16_t track_frog_died_tone[5] = {A,F,E,D,C};
-static uint16_t track_frog_died_duration[5] = {100,100,75,75,200};
-	
-#define TRACK_MADE_IT_SIZE 5
-static uint16_t track_made_it_tone[5] = {C,D,E,F,A};
-static uint16_t track_made_it_duration[5] = {100,100,75,75,200};
-
-#define TRACK_LEVELUP_SIZE 5
-static uint16_t track_levelup_tone[5] = {E,C,C,E,A};
-static uint16_t track_levelup_duration[5] = {100,100,100,100,200};
-
-// unused track while there is infinite levels
-#define TRACK_WINNER_SIZE 6
-static uint16_t track_winner_tone[6] = {C,E,E,A,E,A};
-static uint16_t track_winner_duration[6] = {100,50,50,50,50,200};
-
-#define TRACK_GAME_OVER_SIZE 3
-static uint16_t track_game_over_tone[3] = {E,C,C};
-static uint16_t track_game_over_duration[3] = {100,50,200};
-
-/////////////////// Function Prototypes for Helper Functions ///////////////////
-static uint16_t freq_to_clock_period(uint16_t freq);
-static uint16_t duty_cycle_to_pulse_width(float dutycycle, uint16_t clockperiod);
-static void track_helper(void);
-
-/////////////////////////////// Public Functions ///////////////////////////////
-
-// Initialses the audio hardware for use
-void init_audio(void) {
-freq = 0;
-dutycycle = 20;
-clockperiod = freq_to_clock_period(freq);
-pulsewidth = duty_cycle_to_pulse_width(dutycycle, clockperiod);
-
-// Set the maximum count value for timer/counter 1 to be one less than the clockperiod
-OCR1A = clockperiod - 1;
-
-// Set the count compare value based on the pulse width. The value will be 1 less
-// than the pulse width - unless the pulse width is 0.
-OCR1B = pulsewidth - 1;
-
-// Turns audio output off
-DDRD &= DDRD4_OFF;
-
-// Set up timer/counter 1 for Fast PWM, counting from 0 to the value in OCR1A
-// before reseting to 0. Count at 1MHz (CLK/8).
-// Configure output OC1B to be clear on compare match and set on timer/counter
-// overflow (non-inverting mode).
-TCCR1A = (1 << COM1B1) | (0 <<COM1B0) | (1 <<WGM11) | (1 << WGM10);
-TCCR1B = (1 << WGM13) | (1 << WGM12) | (0 << CS12) | (1 << CS11) | (0 << CS10);
-}
-
-// Loads and plays audio tracks
-void play_audio(int track) {
-	// Turns the volume down if switch S6 is set to 1
-	if(PIND & 0x04) {
-		dutycycle = 0.2;
-	} else {
-		dutycycle = 20;
-	}
-	// If a track is loaded it will continue to play
-	if((track == NO_TRACK) && (is_track_loaded == TRUE)) {
-		// if in a rest period during a track and the rest time has expired 
-		// turn rest off
-		if(rest && (count < array_size) &&
-		(get_current_time() >= (rest_start_time + REST_TIME))) {
-			rest = FALSE;
-		}
-		// If a tone is playing and the tone duration has been reached turn the
-		// tone off and enter the rest period
-		else if(!rest && tone &&
-		(get_current_time() >= (tone_start_time + tone_duration))) {
-			// Turn audio output off
-			DDRD &= DDRD4_OFF;			
-			rest_start_time = get_current_time();
-			rest = TRUE;
-			tone = FALSE;
-		}
-		// If the rest period has ended and there is still more track left
-		// play the next tone in the track
-		else if(!rest && !tone && (count < array_size))  {
-			track_helper();
-		}
-		// If the rest period has ended and there is no more track left
-		// unload the track from use
-		else if(rest && (count >= array_size)) {
-			rest = FALSE;
-			is_track_loaded = FALSE;
-		}
-	}
-	// load frog jump track
-	else if(track == FROG_JUMP) {
-		is_track_loaded = TRUE;
-		count = 0;
-		loaded_track = track_frog_jump_tone;
-		loaded_track_duration = track_frog_jump_duration;
-		array_size = TRACK_FROG_JUMP_SIZE;
-		track_helper();
-	}
-	// load frog died track
-	else if(track == FROG_DIED) {
-		is_track_loaded = TRUE;
-		count = 0;
-		loaded_track = track_frog_died_tone;
-		loaded_track_duration = track_frog_died_duration;
-		array_size = TRACK_FROG_DIED_SIZE;
-		track_helper();
-		// Delay game until finished used instead of _delay_ms()
-		while(is_track_loaded == TRUE) {			
-			play_audio(NO_TRACK);
-		}
-	}
-	// load frog made it track
-	else if(track == FROG_MADE_IT) {
-		is_track_loaded = TRUE;
-		count = 0;
-		loaded_track = track_made_it_tone;
-		loaded_track_duration = track_made_it_duration;
-		array_size = TRACK_MADE_IT_SIZE;
-		track_helper();
-		// Delay game until finished used instead of _delay_ms()
-		while(is_track_loaded == TRUE) {
-			play_audio(NO_TRACK);
-		}
-	}
-	// load level up track
-	else if(track == FROG_LEVELUP) {
-		is_track_loaded = TRUE;
-		count = 0;
-		loaded_track = track_levelup_tone;
-		loaded_track_duration = track_levelup_duration;
-		array_size = TRACK_LEVELUP_SIZE;
-		track_helper();
-	}
-	// load winner track
-	else if(track == WINNER) {
-		is_track_loaded = TRUE;
-		count = 0;
-		loaded_track = track_winner_tone;
-		loaded_track_duration = track_winner_duration;
-		array_size = TRACK_WINNER_SIZE;
-		track_helper();
-		// Delay game until finished used instead of _delay_ms()
-		while(is_track_loaded == TRUE) {
-			play_audio(NO_TRACK);
-		}
-	}
-	// load game over track
-	else if(track == GAME_OVER) {
-		is_track_loaded = TRUE;
-		count = 0;
-		loaded_track = track_game_over_tone;
-		loaded_track_duration = track_game_over_duration;
-		array_size = TRACK_GAME_OVER_SIZE;
-		track_helper();
-		// Delay game until finished used instead of _delay_ms()
-		while(is_track_loaded == TRUE) {
-			play_audio(NO_TRACK);
-		}
-	}
-}
-
-/////////////////////////////// Private (Helper) Functions /////////////////////
-
-// For a given frequency (Hz), return the clock period (in terms of the
-// number of clock cycles of a 1MHz clock)
-static uint16_t freq_to_clock_period(uint16_t freq) {
-	return (1000000UL / freq);
-}
-
-// Return the width of a pulse (in clock cycles) given a duty cycle (%) and
-// the period of the clock (measured in clock cycles)
-static uint16_t duty_cycle_to_pulse_width(float dutycycle, uint16_t clockperiod) {
-	return (dutycycle * clockperiod) / 100;
-}
-
-// Controls what tones will be played and increments the array counter
-static void track_helper(void) {
-	tone = TRUE;
-	freq = loaded_track[count];
-	clockperiod = freq_to_clock_period(freq);
-	pulsewidth = duty_cycle_to_pulse_width(dutycycle, clockperiod);
-	OCR1A = clockperiod - 1;
-	OCR1B = pulsewidth - 1;
-	tone_duration = loaded_track_duration[count];
-	tone_start_time = get_current_time();
-	if((loaded_track[count] != NO_NOTE) && !(PIND & 0x08)) {
-		DDRD |= (1<<DDRD4);
-	}
-	count++;
-}
+/*
+* audio.c
+* 
+* loading and playing audio tracks for the game
+*
+*Author: Michael Bossner
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+
+#include "audio.h"
+#include "timer0.h"
+#include "softtimer.h"
+#include "idle.h"
+#include "game.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// time between each note with no tone
+#define REST_TIME 50
+
+// Notes. NOTE_REST is silence for the length of the step.
+#define NOTE_REST 0
+#define NOTE_C 1
+#define NOTE_D 2
+#define NOTE_E 3
+#define NOTE_F 4
+#define NOTE_G 5
+#define NOTE_GS 6
+#define NOTE_A 7
+#define NOTE_AS 8
+#define NOTE_B 9
+#define NOTE_CH 10
+#define NOTE_CSH 11
+#define NOTE_DH 12
+#define NOTE_DSH 13
+#define NOTE_EH 14
+#define NOTE_FH 15
+#define NOTE_FSH 16
+#define NOTE_GH 17
+#define NOTE_GSH 18
+#define NOTE_AH 19
+#define NUM_NOTES 20
+
+// Timer 1 counts at 1MHz. For a note of frequency f (Hz) OCR1A sets the
+// period. The pulse width at full volume gives a 20% duty cycle - OCR1B is
+// set to a fraction of it by the volume and envelope.
+#define PERIOD(f) (1000000UL / (f))
+#define NOTE_TIMER(f) { PERIOD(f) - 1, PERIOD(f) / 5 }
+
+// OCR1A value and full volume pulse width for every note
+static const uint16_t note_timer[NUM_NOTES][2] PROGMEM = {
+	[NOTE_REST] = { 0xFFFF, 0 },
+	[NOTE_C] = NOTE_TIMER(261),
+	[NOTE_D] = NOTE_TIMER(294),
+	[NOTE_E] = NOTE_TIMER(329),
+	[NOTE_F] = NOTE_TIMER(349),
+	[NOTE_G] = NOTE_TIMER(391),
+	[NOTE_GS] = NOTE_TIMER(415),
+	[NOTE_A] = NOTE_TIMER(440),
+	[NOTE_AS] = NOTE_TIMER(455),
+	[NOTE_B] = NOTE_TIMER(466),
+	[NOTE_CH] = NOTE_TIMER(523),
+	[NOTE_CSH] = NOTE_TIMER(554),
+	[NOTE_DH] = NOTE_TIMER(587),
+	[NOTE_DSH] = NOTE_TIMER(622),
+	[NOTE_EH] = NOTE_TIMER(659),
+	[NOTE_FH] = NOTE_TIMER(698),
+	[NOTE_FSH] = NOTE_TIMER(740),
+	[NOTE_GH] = NOTE_TIMER(784),
+	[NOTE_GSH] = NOTE_TIMER(830),
+	[NOTE_AH] = NOTE_TIMER(880)
+};
+
+// Tracks are stored in flash as two byte steps:
+//	STEP(note, ms)		play a note (or rest) for ms (a multiple of
+//				DURATION_UNIT up to 1275)
+//	REPEAT(back, times)	go back the given number of steps and play them
+//				again, times more times (repeats don't nest)
+//	TRACK_END		the last step
+#define DURATION_UNIT 5
+#define STEP(note, ms) NOTE_##note, ((ms) / DURATION_UNIT)
+#define REPEAT_FLAG 0x80
+#define REPEAT(back, times) (REPEAT_FLAG | (back)), (times)
+#define END_OF_TRACK 0x7F
+#define TRACK_END END_OF_TRACK, 0
+#define STEP_SIZE 2
+// repeat_left while not repeating
+#define NOT_REPEATING 0xFF
+
+// Background music. Loops until stopped.
+static const uint8_t track_bgm[] PROGMEM = {
+	STEP(A, 500), STEP(A, 500), STEP(A, 500), STEP(F, 350), STEP(CH, 150),
+	STEP(A, 500), STEP(F, 350), STEP(CH, 150), STEP(A, 650), STEP(REST, 500),
+	STEP(EH, 500), STEP(EH, 500), STEP(EH, 500), STEP(FH, 350),
+	STEP(CH, 150), STEP(GS, 500), STEP(F, 350), STEP(CH, 150), STEP(A, 650),
+	STEP(REST, 500), STEP(AH, 500), STEP(A, 300), STEP(A, 150),
+	STEP(AH, 500), STEP(GSH, 325), STEP(GH, 175), STEP(FSH, 125),
+	STEP(FH, 125), STEP(FSH, 250), STEP(REST, 325), STEP(AS, 250),
+	STEP(DSH, 500), STEP(DH, 325), STEP(CSH, 175), STEP(CH, 125),
+	STEP(B, 125), STEP(CH, 250), STEP(REST, 350), STEP(F, 250),
+	STEP(GS, 500), STEP(F, 350), STEP(A, 125), STEP(CH, 500), STEP(A, 375),
+	STEP(CH, 125), STEP(EH, 650), STEP(REST, 500), STEP(AH, 500),
+	STEP(A, 300), STEP(A, 150), STEP(AH, 500), STEP(GSH, 325),
+	STEP(GH, 175), STEP(FSH, 125), STEP(FH, 125), STEP(FSH, 250),
+	STEP(REST, 325), STEP(AS, 250), STEP(DSH, 500), STEP(DH, 325),
+	STEP(CSH, 175), STEP(CH, 125), STEP(B, 125), STEP(CH, 250),
+	STEP(REST, 350), STEP(F, 250), STEP(GS, 500), STEP(F, 375),
+	STEP(CH, 125), STEP(A, 500), STEP(F, 375), STEP(CH, 125), STEP(A, 650),
+	STEP(REST, 650), TRACK_END
+};
+
+// Audio Tracks
+static const uint8_t track_frog_jump[] PROGMEM = {
+	STEP(A, 50), STEP(C, 25), TRACK_END
+};
+
+static const uint8_t track_frog_died[] PROGMEM = {
+	STEP(A, 100), STEP(F, 100), STEP(E, 75), STEP(D, 75), STEP(C, 200),
+	TRACK_END
+};
+
+static const uint8_t track_made_it[] PROGMEM = {
+	STEP(C, 100), STEP(D, 100), STEP(E, 75), STEP(F, 75), STEP(A, 200),
+	TRACK_END
+};
+
+static const uint8_t track_levelup[] PROGMEM = {
+	STEP(E, 100), STEP(C, 100), REPEAT(1, 1), STEP(E, 100), STEP(A, 200),
+	TRACK_END
+};
+
+// unused track while there is infinite levels
+static const uint8_t track_winner[] PROGMEM = {
+	STEP(C, 100), STEP(E, 50), STEP(E, 50), STEP(A, 50), STEP(E, 50),
+	STEP(A, 200), TRACK_END
+};
+
+static const uint8_t track_game_over[] PROGMEM = {
+	STEP(E, 100), STEP(C, 50), STEP(C, 200), TRACK_END
+};
+
+// Scale (out of 64) each volume level applies to the envelope. Quiet is about
+// the 0.2% duty cycle the S6 switch always gave.
+static const uint8_t volume_scale[NUM_VOLUMES] PROGMEM = {
+	[VOLUME_OFF] = 0,
+	[VOLUME_QUIET] = 1,
+	[VOLUME_MEDIUM] = 16,
+	[VOLUME_LOUD] = 64
+};
+
+// Envelopes give the level (out of 64) of a note every ENVELOPE_MS ms from
+// its start - a short attack then a decay to the last entry, which is held
+// until the note ends. ENVELOPE_MS must be a power of two.
+#define ENVELOPE_MS 4
+#define ENVELOPE_LENGTH 16
+#define ENVELOPE_END ((ENVELOPE_LENGTH - 1) * ENVELOPE_MS)
+static const uint8_t effect_envelope[ENVELOPE_LENGTH] PROGMEM = {
+	24, 48, 64, 64, 60, 56, 52, 48, 48, 48, 48, 48, 48, 48, 48, 48
+};
+static const uint8_t music_envelope[ENVELOPE_LENGTH] PROGMEM = {
+	8, 24, 40, 56, 64, 58, 52, 46, 42, 38, 36, 34, 32, 32, 32, 32
+};
+
+// Switches S6 (quiet) and S7 (mute) on port D are read every SWITCH_PERIOD
+// ms by the timer interrupt
+#define SWITCH_PERIOD 10
+#define SWITCH_QUIET 0x04
+#define SWITCH_MUTE 0x08
+#define SWITCH_MASK (SWITCH_QUIET | SWITCH_MUTE)
+// switches value that forces the scale to be worked out again
+#define SWITCHES_UNKNOWN 0xFF
+
+// Effect priorities. An effect interrupts one of the same or lower priority.
+// Higher priority effects can't be interrupted - a PRIORITY_LOW effect is
+// dropped and others wait for them to finish.
+#define PRIORITY_LOW 1
+#define PRIORITY_EVENT 2
+#define PRIORITY_FANFARE 3
+// priority of a channel with no track loaded
+#define PRIORITY_NONE 0
+
+typedef struct {
+	const uint8_t* steps;
+	uint8_t priority;
+} Track;
+
+// Effects indexed by the track macros in audio.h
+static const Track tracks[] PROGMEM = {
+	[FROG_JUMP] = { track_frog_jump, PRIORITY_LOW },
+	[FROG_DIED] = { track_frog_died, PRIORITY_EVENT },
+	[FROG_MADE_IT] = { track_made_it, PRIORITY_EVENT },
+	[FROG_LEVELUP] = { track_levelup, PRIORITY_FANFARE },
+	[WINNER] = { track_winner, PRIORITY_FANFARE },
+	[GAME_OVER] = { track_game_over, PRIORITY_FANFARE }
+};
+#define NUM_TRACKS (sizeof(tracks) / sizeof(tracks[0]))
+
+// Step durations are scaled by unit16 (ms per step unit x 16) so the music
+// tempo can change. Effects always play at normal speed.
+#define EFFECT_UNIT16 (DURATION_UNIT * 16)
+// Music tempo limits (percent of normal speed)
+#define MIN_TEMPO 50
+#define MAX_TEMPO 200
+
+// A track being played. Tracks are played by audio_tick() from the timer 0
+// interrupt handler - the main program only loads them.
+typedef struct {
+	const uint8_t* position;	// the next step (in flash)
+	uint8_t repeat_left;
+	uint8_t note;
+	uint8_t tone;			// FALSE during the rest after a note
+	uint16_t time_left;		// ms left of the note or rest
+	uint8_t elapsed;		// ms since the note started (up to ENVELOPE_END)
+	const uint8_t* envelope;	// (in flash)
+	uint8_t unit16;
+	volatile uint8_t priority;	// PRIORITY_NONE if nothing is loaded
+} Channel;
+
+// Effects play over the music, which carries on from the same point once
+// the effect has finished
+static Channel effect;
+static Channel music;
+// An effect waiting for a higher priority one to finish (0 if none)
+static uint8_t queued_track;
+
+// Volume chosen with set_volume(), the switches last read and the volume
+// scale that results
+static volatile uint8_t volume = VOLUME_LOUD;
+static volatile uint8_t switches = SWITCHES_UNKNOWN;
+static uint8_t master_scale;
+static uint8_t switch_timer;
+// Soft timer that plays the tracks, or -1 if none was free. Nothing is
+// played without one.
+static int8_t audio_timer = -1;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+static void start_effect(uint8_t track);
+static uint8_t advance(Channel* channel);
+static uint8_t track_helper(Channel* channel);
+static void output_note(Channel* channel);
+static void update_volume(Channel* channel);
+static void silence(void);
+static uint8_t sample_switches(void);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Initialses the audio hardware for use
+void init_audio(void) {
+// Set the maximum count value for timer/counter 1 to be one less than the clockperiod
+OCR1A = pgm_read_word(&note_timer[NOTE_REST][0]);
+
+// Set the count compare value based on the pulse width. The value will be 1 less
+// than the pulse width - unless the pulse width is 0.
+OCR1B = 0;
+
+// Turns audio output off
+DDRD &= DDRD4_OFF;
+
+// Set up timer/counter 1 for Fast PWM, counting from 0 to the value in OCR1A
+// before reseting to 0. Count at 1MHz (CLK/8).
+// Configure output OC1B to be clear on compare match and set on timer/counter
+// overflow (non-inverting mode).
+TCCR1A = (1 << COM1B1) | (0 <<COM1B0) | (1 <<WGM11) | (1 << WGM10);
+TCCR1B = (1 << WGM13) | (1 << WGM12) | (0 << CS12) | (1 << CS11) | (0 << CS10);
+
+effect.unit16 = EFFECT_UNIT16;
+effect.envelope = effect_envelope;
+music.envelope = music_envelope;
+set_music_tempo(100);
+
+// Notes are timed to the millisecond so audio runs before anything else that
+// is due in the same tick. Tracks are paused with the game clock.
+audio_timer = softtimer_add(audio_tick, 1, SOFTTIMER_PRIORITY_HIGH,
+		SOFTTIMER_GAME_CLOCK, PSTR("audio"));
+}
+
+// Starts playing an effect if nothing more important is playing
+void play_audio(int track) {
+	// Nothing would end the effect (see audio_await())
+	if(audio_timer < 0) {
+		return;
+	}
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	if(track <= 0 || track >= NUM_TRACKS) {
+		// Stop the effects. The music carries on.
+		queued_track = 0;
+		effect.priority = PRIORITY_NONE;
+		if(music.priority && music.tone) {
+			output_note(&music);
+		} else {
+			silence();
+		}
+	} else {
+		uint8_t priority = pgm_read_byte(&tracks[track].priority);
+		if(priority >= effect.priority) {
+			start_effect(track);
+		} else if(priority > PRIORITY_LOW && (queued_track == 0 ||
+				priority >= pgm_read_byte(&tracks[queued_track].priority))) {
+			queued_track = track;
+		}
+	}
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+// Returns TRUE while an effect is playing or waiting to play
+uint8_t audio_playing(void) {
+	return effect.priority != PRIORITY_NONE;
+}
+
+// Sleeps until the effects have finished
+void audio_await(void) {
+	while(effect.priority != PRIORITY_NONE) {
+		idle();
+	}
+}
+
+// Starts the background music from the beginning
+void play_music(void) {
+	if(audio_timer < 0) {
+		return;
+	}
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	music.position = track_bgm;
+	music.repeat_left = NOT_REPEATING;
+	music.priority = PRIORITY_LOW;
+	if(effect.priority == PRIORITY_NONE) {
+		track_helper(&music);
+	} else {
+		// Start when the effect has finished
+		music.note = NOTE_REST;
+		music.tone = FALSE;
+		music.time_left = 1;
+	}
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+void stop_music(void) {
+	uint8_t interrupts_on = bit_is_set(SREG, SREG_I);
+	cli();
+	music.priority = PRIORITY_NONE;
+	if(effect.priority == PRIORITY_NONE) {
+		silence();
+	}
+	if(interrupts_on) {
+		sei();
+	}
+}
+
+// Sets the speed of the music as a percentage of normal. Takes effect from
+// the next note.
+void set_music_tempo(uint8_t percent) {
+	if(percent < MIN_TEMPO) {
+		percent = MIN_TEMPO;
+	} else if(percent > MAX_TEMPO) {
+		percent = MAX_TEMPO;
+	}
+	music.unit16 = (EFFECT_UNIT16 * 100) / percent;
+}
+
+// Sets the volume (see VOLUME_ in audio.h). The switches are applied on top.
+void set_volume(uint8_t level) {
+	if(level < NUM_VOLUMES) {
+		volume = level;
+		// Work the scale out again next tick
+		switches = SWITCHES_UNKNOWN;
+	}
+}
+
+uint8_t get_volume(void) {
+	return volume;
+}
+
+// Plays the loaded tracks. Every tone is followed by a rest of REST_TIME ms
+// (scaled by the tempo) with the output off. The music is held while an
+// effect plays. Called every ms from the timer 0 interrupt handler.
+void audio_tick(void) {
+	Channel* playing;
+	uint8_t volume_changed = sample_switches();
+
+	if(effect.priority != PRIORITY_NONE) {
+		if(!advance(&effect)) {
+			effect.priority = PRIORITY_NONE;
+			if(queued_track) {
+				start_effect(queued_track);
+			} else if(music.priority && music.tone) {
+				// Carry on with the music note that was interrupted
+				output_note(&music);
+			}
+			return;
+		}
+		playing = &effect;
+	} else if(music.priority != PRIORITY_NONE) {
+		if(!advance(&music)) {
+			// Loop back to the start
+			music.position = track_bgm;
+			track_helper(&music);
+		}
+		playing = &music;
+	} else {
+		return;
+	}
+
+	// Follow the envelope of the note playing
+	if(playing->tone && (volume_changed ||
+			(playing->elapsed < ENVELOPE_END &&
+			++playing->elapsed % ENVELOPE_MS == 0))) {
+		update_volume(playing);
+	}
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Starts an effect in place of any effect playing
+static void start_effect(uint8_t track) {
+	queued_track = 0;
+	effect.position = (const uint8_t*)pgm_read_word(&tracks[track].steps);
+	effect.repeat_left = NOT_REPEATING;
+	effect.priority = pgm_read_byte(&tracks[track].priority);
+	if(!track_helper(&effect)) {
+		effect.priority = PRIORITY_NONE;
+	}
+}
+
+// Counts down the note or rest being played and moves on to the next one.
+// Returns FALSE once the rest after the last note has finished.
+static uint8_t advance(Channel* channel) {
+	if(--channel->time_left != 0) {
+		return TRUE;
+	}
+	if(channel->tone) {
+		// Tone finished - turn the output off for the rest period
+		DDRD &= DDRD4_OFF;
+		channel->tone = FALSE;
+		channel->time_left = ((REST_TIME / DURATION_UNIT) * channel->unit16)
+				>> 4;
+		return TRUE;
+	}
+	return track_helper(channel);
+}
+
+// Starts the next note of the track. Repeats are followed first. Returns
+// FALSE if the track has ended.
+static uint8_t track_helper(Channel* channel) {
+	uint8_t note = pgm_read_byte(channel->position);
+	uint8_t length = pgm_read_byte(channel->position + 1);
+
+	if(note & REPEAT_FLAG) {
+		if(channel->repeat_left == NOT_REPEATING) {
+			channel->repeat_left = length;
+		}
+		if(channel->repeat_left == 0) {
+			channel->repeat_left = NOT_REPEATING;
+			channel->position += STEP_SIZE;
+		} else {
+			channel->repeat_left--;
+			channel->position -= (note & ~REPEAT_FLAG) * STEP_SIZE;
+		}
+		note = pgm_read_byte(channel->position);
+		length = pgm_read_byte(channel->position + 1);
+	}
+	if(note == END_OF_TRACK) {
+		return FALSE;
+	}
+	channel->position += STEP_SIZE;
+	channel->note = note;
+	channel->tone = TRUE;
+	channel->time_left = ((uint16_t)length * channel->unit16) >> 4;
+	if(channel->time_left == 0) {
+		channel->time_left = 1;
+	}
+	output_note(channel);
+	return TRUE;
+}
+
+// Sets the buzzer to play the channel's note from the start of its envelope
+static void output_note(Channel* channel) {
+	OCR1A = pgm_read_word(&note_timer[channel->note][0]);
+	channel->elapsed = 0;
+	update_volume(channel);
+}
+
+// Sets the pulse width for the channel's note from its envelope and the
+// volume. The output is turned off for a rest or if the volume is off.
+static void update_volume(Channel* channel) {
+	uint8_t level = pgm_read_byte(
+			&channel->envelope[channel->elapsed / ENVELOPE_MS]);
+	// Scale out of 256 - the level and master scale are out of 64
+	uint16_t scale = (level * master_scale) >> 4;
+	uint16_t pulse = ((uint32_t)pgm_read_word(&note_timer[channel->note][1]) *
+			scale) >> 8;
+	OCR1B = pulse ? pulse - 1 : 0;
+	if((channel->note != NOTE_REST) && master_scale != 0) {
+		DDRD |= (1<<DDRD4);
+	} else {
+		DDRD &= DDRD4_OFF;
+	}
+}
+
+static void silence(void) {
+	DDRD &= DDRD4_OFF;
+}
+
+// Reads the switches every SWITCH_PERIOD ms and works out the volume scale.
+// Returns TRUE if it has changed.
+static uint8_t sample_switches(void) {
+	if(++switch_timer < SWITCH_PERIOD && switches != SWITCHES_UNKNOWN) {
+		return FALSE;
+	}
+	switch_timer = 0;
+	uint8_t now = PIND & SWITCH_MASK;
+	if(now == switches) {
+		return FALSE;
+	}
+	switches = now;
+	uint8_t level = volume;
+	if(now & SWITCH_MUTE) {
+		level = VOLUME_OFF;
+	} else if((now & SWITCH_QUIET) && level > VOLUME_QUIET) {
+		level = VOLUME_QUIET;
+	}
+	master_scale = pgm_read_byte(&volume_scale[level]);
+	return TRUE;
+}
@@ -1,45 +1,90 @@
-/*
-* audio.h
-*
-* Functions and Macros for playing game audio
-*
-*Author: Michael Bossner
-*/
-
-#ifndef AUDIO_H_
-#define AUDIO_H_
-
-#include <stdint.h>
-
-// No track is to be loaded
-#define NO_TRACK -1
-// Frog jumping audio track
-#define FROG_JUMP 1
-// Frog died audio track
-#define FROG_DIED 2
-// Frog made it to the other side audio track
-#define FROG_MADE_IT 3
-// Frog filled the riverbank audio track
-#define FROG_LEVELUP 4
-// Frog won the game audio track
-// Unused while there are infinite levels
-#define WINNER 5
-// Game Over audio track
-#define GAME_OVER 6
-// Used for turning off audio on DDRD with a bit mask eg. (DDRD &= DDRD4_OFF)
-#define DDRD4_OFF 0xEF
-
-// Initalises the audio hardware for use in playing tones to DDRD4
-void init_audio(void);
-
-/* 
-* Loads and plays the audio tracks. A track must be loaded to start the audio
-* and the function must be called frequently after with the NO_TRACK macro
-* to continue playing the audio track to completion.
-* FROG_DIED, FROG_MADE_IT, WINNER and GAME_OVER tracks will play to completion
-* without another call to the function. Done by design to delay the game in
-* certain places.
-*/
-void play_audio(int track);
-
+/*
+* audio.h
+*
+* Functions and Macros for playing game audio
+*
+*Author: Michael Bossner
+*/
+
+#ifndef AUDIO_H_
+#define AUDIO_H_
+
+#include <stdint.h>
+
+// Stops the track being played
+#define NO_TRACK -1
+// Frog jumping audio track
+#define FROG_JUMP 1
+// Frog died audio track
+#define FROG_DIED 2
+// Frog made it to the other side audio track
+#define FROG_MADE_IT 3
+// Frog filled the riverbank audio track
+#define FROG_LEVELUP 4
+// Frog won the game audio track
+// Unused while there are infinite levels
+#define WINNER 5
+// Game Over audio track
+#define GAME_OVER 6
+// Used for turning off audio on DDRD with a bit mask eg. (DDRD &= DDRD4_OFF)
+#define DDRD4_OFF 0xEF
+
+// Volume levels (see set_volume())
+#define VOLUME_OFF 0
+#define VOLUME_QUIET 1
+#define VOLUME_MEDIUM 2
+#define VOLUME_LOUD 3
+#define NUM_VOLUMES 4
+
+// Initalises the audio hardware for use in playing tones to DDRD4
+void init_audio(void);
+
+/* 
+* Starts playing a sound effect. Effects play to completion in the background
+* (see audio_tick()) so this never waits. Each effect has a priority - a jump
+* is the lowest, dying and reaching the riverbank are in the middle and level
+* up, winner and game over are the highest. An effect interrupts one of the
+* same or lower priority. Otherwise a jump is dropped and other effects wait
+* until the one playing has finished. Effects play over the background music
+* which carries on afterwards. NO_TRACK stops the effects.
+*/
+void play_audio(int track);
+
+/*
+* Returns non-zero while an effect is playing or waiting to play.
+*/
+uint8_t audio_playing(void);
+
+/*
+* Waits (sleeping) until the effects have finished playing. Tracks don't
+* advance while the game clock is paused so must not be called while paused.
+*/
+void audio_await(void);
+
+/*
+* Starts the background music from the beginning. It loops until stopped.
+*/
+void play_music(void);
+void stop_music(void);
+
+/*
+* Sets the speed of the background music as a percentage of normal speed
+* (50 to 200). Takes effect from the next note.
+*/
+void set_music_tempo(uint8_t percent);
+
+/*
+* Sets or returns the volume (VOLUME_OFF to VOLUME_LOUD, the default). Switch
+* S6 turns the volume down to VOLUME_QUIET and S7 turns it off - the switches
+* are read by audio_tick() so they apply even to a note already playing.
+*/
+void set_volume(uint8_t level);
+uint8_t get_volume(void);
+
+/*
+* Advances the track being played by 1 ms. Called by a soft timer from the
+* timer 0 interrupt handler while the game clock isn't paused.
+*/
+void audio_tick(void);
+
 #endif
\ No newline at end of file
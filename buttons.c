@@ -1,114 +1,170 @@
-/*
- * buttons.c
- *
- * Author: Peter Sutton modified by Michael Bossner
- */
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include "buttons.h"
-
-// Global variable to keep track of the last button state so that we
-// can detect changes when an interrupt fires. The lower 4 bits (0 to 3)
-// will correspond to the last state of port B pins 0 to 3.
-static volatile uint8_t last_button_state;
-
-// Our button queue. button_queue[0] is always the head of the queue. If we
-// take something off the queue we just move everything else along. We don't
-// use a circular buffer since it is usually expected that the queue is very
-// short. In most uses it will never have more than 1 element at a time.
-// This button queue can be changed by the interrupt handler below so we should
-// turn off interrupts if we're changing the queue outside the handler.
-#define BUTTON_QUEUE_SIZE 4
-static volatile uint8_t button_queue[BUTTON_QUEUE_SIZE];
-static volatile int8_t queue_length;
-static volatile int8_t button_held = NO_BUTTON_PUSHED;
-
-// Setup interrupt if any of pins B0 to B3 change. We do this
-// using a pin change interrupt. These pins correspond to pin
-// change interrupts PCINT8 to PCINT11 which are covered by
-// Pin change interrupt 1.
-void init_button_interrupts(void) {
-	// Enable the interrupt (see datasheet page 91)
-	PCICR |= (1<<PCIE1);
-
-	// Make sure the interrupt flag is cleared (by writing a
-	// 1 to it) (see datasheet page 92)
-	PCIFR |= (1<<PCIF1);
-
-	// Choose which pins we're interested in by setting
-	// the relevant bits in the mask register (see datasheet page 94)
-	PCMSK1 |= (1<<PCINT8)|(1<<PCINT9)|(1<<PCINT10)|(1<<PCINT11);
-
-	// Empty the button push queue
-	queue_length = 0;
-}
-
-// clears all buttons that are queued
-void clear_button_queue(void) {
-	for(uint8_t i = 0; i < BUTTON_QUEUE_SIZE; i++) {
-		button_queue[i] = NO_BUTTON_PUSHED;
-	}
-	queue_length = 0;
-}
-
-int8_t button_pushed(void) {
-	int8_t return_value = NO_BUTTON_PUSHED;	// Assume no button pushed
-	if(queue_length > 0) {
-		// Remove the first element off the queue and move all the other
-		// entries closer to the front of the queue. We turn off interrupts (if on)
-		// before we make any changes to the queue. If interrupts were on
-		// we turn them back on when done.
-		return_value = button_queue[0];
-
-		// Save whether interrupts were enabled and turn them off
-		int8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
-		cli();
-
-		for(uint8_t i = 1; i < queue_length; i++) {
-			button_queue[i-1] = button_queue[i];
-		}
-		queue_length--;
-
-		if(interrupts_were_enabled) {
-			// Turn them back on again
-			sei();
-		}
-	}
-	return return_value;
-}
-
-// returns the state of button_held
-int8_t is_button_held(void) {
-	int8_t return_value = button_held;
-	return return_value;
-}
-
-// Interrupt handler for a change on buttons
-ISR(PCINT1_vect) {
-	// Get the current state of the buttons. We'll compare this with
-	// the last state to see what has changed.
-	uint8_t button_state = PINB & 0x0F;
-
-	// Iterate over all the buttons and see which ones have changed.
-	// Any button pushes are added to the queue of button pushes (if
-	// there is space). We ignore button releases so we're just looking
-	// for a transition from 0 in the last_button_state bit to a 1 in the
-	// button_state.
-	for(uint8_t pin=0; pin<=3; pin++) {
-		if(queue_length < BUTTON_QUEUE_SIZE &&
-				(button_state & (1<<pin)) &&
-				!(last_button_state & (1<<pin))) {
-			// Add the button push to the queue (and update the
-			// length of the queue
-			button_queue[queue_length++] = pin;
-			button_held = pin;
-		}
-	}
-	if(!(button_state & (1<<button_held)) &&
-			(last_button_state & (1<<button_held))) {
-			button_held = NO_BUTTON_PUSHED;
-	}
-	// Remember this button state
-	last_button_state = button_state;
-}
\ No newline at end of file
+/*
+ * buttons.c
+ *
+ * Author: Peter Sutton modified by Michael Bossner
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "buttons.h"
+#include "repeat.h"
+#include "timer0.h"
+#include "softtimer.h"
+
+// Buttons B0 to B3 are on the lower 4 bits of port B
+#define BUTTON_MASK 0x0F
+
+// Vertical counters for debouncing. Each bit position is an independent
+// 2 bit counter (vc_high:vc_low) for the button on that pin. A counter is
+// reset while the pin agrees with the debounced state and counts down while
+// it differs. The debounced state only changes after BUTTON_STABLE_SAMPLES
+// samples in a row disagree with it, so contact bounce is filtered out for
+// all 4 buttons at once.
+static uint8_t vc_low;
+static uint8_t vc_high;
+static volatile uint8_t debounced_state;
+
+// Our button queue. button_queue[0] is always the head of the queue. If we
+// take something off the queue we just move everything else along. We don't
+// use a circular buffer since it is usually expected that the queue is very
+// short. In most uses it will never have more than 1 element at a time.
+// This button queue can be changed by the interrupt handler below so we should
+// turn off interrupts if we're changing the queue outside the handler.
+#define BUTTON_QUEUE_SIZE 4
+static volatile uint8_t button_queue[BUTTON_QUEUE_SIZE];
+// Fine time stamp (see get_fine_time32()) of each push in the queue
+static volatile uint32_t button_stamps[BUTTON_QUEUE_SIZE];
+static volatile int8_t queue_length;
+
+// Soft timer that samples the buttons, or -1 if none was free. Without one
+// the buttons are sampled from button_pushed() instead.
+static int8_t sample_timer = -1;
+// When button_pushed() last sampled the buttons (see get_ticks16())
+static uint16_t last_sample;
+// Stamp of the push last returned by button_pushed()
+static uint32_t last_stamp;
+static volatile int8_t button_held = NO_BUTTON_PUSHED;
+// Auto-repeat state for the held button
+static RepeatState button_repeat;
+
+static void debounce_buttons(void);
+static void queue_button(uint8_t pin, uint32_t stamp);
+
+// Set up the debouncer. The buttons are sampled by a soft timer (see
+// debounce_buttons()) rather than from pin change interrupts so that contact
+// bounce can't queue extra pushes. It keeps running while the game is paused
+// so a push can be seen.
+void init_buttons(void) {
+	// Start with every counter reset and every button released
+	vc_low = 0xFF;
+	vc_high = 0xFF;
+	debounced_state = 0;
+	button_held = NO_BUTTON_PUSHED;
+	repeat_reset(&button_repeat);
+
+	// Empty the button push queue
+	queue_length = 0;
+
+	sample_timer = softtimer_add(debounce_buttons, BUTTON_SAMPLE_PERIOD,
+			SOFTTIMER_PRIORITY_NORMAL, 0, PSTR("buttons"));
+	last_sample = get_ticks16();
+}
+
+// clears all buttons that are queued
+void clear_button_queue(void) {
+	for(uint8_t i = 0; i < BUTTON_QUEUE_SIZE; i++) {
+		button_queue[i] = NO_BUTTON_PUSHED;
+	}
+	queue_length = 0;
+}
+
+int8_t button_pushed(void) {
+	int8_t return_value = NO_BUTTON_PUSHED;	// Assume no button pushed
+	if(sample_timer < 0 && ticks_since(last_sample) >= BUTTON_SAMPLE_PERIOD) {
+		last_sample = get_ticks16();
+		debounce_buttons();
+	}
+	if(queue_length > 0) {
+		// Remove the first element off the queue and move all the other
+		// entries closer to the front of the queue. We turn off interrupts (if on)
+		// before we make any changes to the queue. If interrupts were on
+		// we turn them back on when done.
+		return_value = button_queue[0];
+
+		// Save whether interrupts were enabled and turn them off
+		int8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+		cli();
+
+		last_stamp = button_stamps[0];
+		for(uint8_t i = 1; i < queue_length; i++) {
+			button_queue[i-1] = button_queue[i];
+			button_stamps[i-1] = button_stamps[i];
+		}
+		queue_length--;
+
+		if(interrupts_were_enabled) {
+			// Turn them back on again
+			sei();
+		}
+	}
+	return return_value;
+}
+
+// returns the time stamp of the last push returned
+uint32_t get_button_stamp(void) {
+	return last_stamp;
+}
+
+// returns the state of button_held
+int8_t is_button_held(void) {
+	int8_t return_value = button_held;
+	return return_value;
+}
+
+// Called by a soft timer every BUTTON_SAMPLE_PERIOD ms from the timer 0
+// interrupt handler. The buttons are sampled and the vertical counters
+// updated. Debounced pushes are added to the queue, as are repeats of the
+// button being held.
+static void debounce_buttons(void) {
+	uint32_t now = get_current_time();
+	uint32_t stamp = get_fine_time32();
+
+	// Bits are set for buttons whose sample differs from the debounced state
+	uint8_t changed = (PINB & BUTTON_MASK) ^ debounced_state;
+
+	// Count down the counters of buttons that differ and reset the rest.
+	// Only counters that have wrapped around are left set in changed.
+	vc_low = ~(vc_low & changed);
+	vc_high = vc_low ^ (vc_high & changed);
+	changed &= vc_low & vc_high;
+	debounced_state ^= changed;
+
+	// Any button pushes are added to the queue (if there is space). We
+	// ignore button releases so we're just looking for debounced
+	// transitions from 0 to 1.
+	uint8_t pushed = changed & debounced_state;
+	for(uint8_t pin=0; pin<=3; pin++) {
+		if(pushed & (1<<pin)) {
+			queue_button(pin, stamp);
+			button_held = pin;
+			repeat_start(&button_repeat, pin, now);
+		}
+	}
+	if(button_held != NO_BUTTON_PUSHED &&
+			!(debounced_state & (1<<button_held))) {
+		button_held = NO_BUTTON_PUSHED;
+	}
+
+	int16_t repeat = repeat_due(&button_repeat, button_held, now);
+	if(repeat != NO_KEY_HELD) {
+		queue_button(repeat, stamp);
+	}
+}
+
+// Adds a button push to the queue if there is space
+static void queue_button(uint8_t pin, uint32_t stamp) {
+	if(queue_length < BUTTON_QUEUE_SIZE) {
+		button_stamps[queue_length] = stamp;
+		button_queue[queue_length++] = pin;
+	}
+}
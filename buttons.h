@@ -1,42 +1,50 @@
-/*
- * buttons.h
- *
- * Author: Peter Sutton. Modified by Michael Bossner
- *
- * We assume four push buttons (B0 to B3) are connected to pins B0 to B3. We configure
- * pin change interrupts on these pins.
- */
-
-
-#ifndef BUTTONS_H_
-#define BUTTONS_H_
-
-#include <stdint.h>
-
-#define NO_BUTTON_PUSHED (-1)
-
-/* Set up pin change interrupts on pins B0 to B3.
- * It is assumed that global interrupts are off when this function is called
- * and are enabled sometime after this function is called.
- */
-void init_button_interrupts(void);
-
-/* Return the last button pushed (0 to 3) or -1 (NO_BUTTON_PUSHED) if
- * there are no button pushes to return. (A small queue of button pushes
- * is kept. This function should be called frequently enough to
- * ensure the queue does not overflow. Excess button pushes are
- * discarded.)
- */
-int8_t button_pushed(void);
-
-// Clears the button queue
-void clear_button_queue(void);
-
-/* Returns the current button held. If more then one button is held the most
- * recent button to be held is returned. If no button is held NO_BUTTON_PUSHED
- * is returned.
- */
-int8_t is_button_held(void);
-
-
-#endif /* BUTTONS_H_ */
\ No newline at end of file
+/*
+ * buttons.h
+ *
+ * Author: Peter Sutton. Modified by Michael Bossner
+ *
+ * We assume four push buttons (B0 to B3) are connected to pins B0 to B3. The
+ * pins are sampled and debounced from the timer 0 interrupt.
+ */
+
+
+#ifndef BUTTONS_H_
+#define BUTTONS_H_
+
+#include <stdint.h>
+
+#define NO_BUTTON_PUSHED (-1)
+
+// Time (ms) between button samples. A push or release is only accepted once
+// it has been stable for 4 samples in a row.
+#define BUTTON_SAMPLE_PERIOD 5
+
+/* Set up debouncing of pins B0 to B3.
+ * It is assumed that global interrupts are off when this function is called
+ * and are enabled sometime after this function is called.
+ */
+void init_buttons(void);
+
+/* Return the last button pushed (0 to 3) or -1 (NO_BUTTON_PUSHED) if
+ * there are no button pushes to return. (A small queue of button pushes
+ * is kept. This function should be called frequently enough to
+ * ensure the queue does not overflow. Excess button pushes are
+ * discarded.) A held button is queued again each time it auto-repeats.
+ */
+int8_t button_pushed(void);
+
+/* Returns the fine time stamp (see get_fine_time32()) of the push last
+ * returned by button_pushed(), i.e. when the debounced push was seen.
+ */
+uint32_t get_button_stamp(void);
+
+// Clears the button queue
+void clear_button_queue(void);
+
+/* Returns the current button held. If more then one button is held the most
+ * recent button to be held is returned. If no button is held NO_BUTTON_PUSHED
+ * is returned.
+ */
+int8_t is_button_held(void);
+
+#endif /* BUTTONS_H_ */
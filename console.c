@@ -0,0 +1,533 @@
+/*
+* console.c
+*
+* Author: Michael Bossner
+*/
+
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "console.h"
+#include "serialio.h"
+#include "terminalio.h"
+#include "keymap.h"
+#include "level.h"
+#include "game.h"
+#include "timer0.h"
+#include "countdown.h"
+#include "latency.h"
+#include "ledmatrix.h"
+#include "spi.h"
+#include "highscore.h"
+#include "levelbank.h"
+#include "audio.h"
+#include "softtimer.h"
+#include "idle.h"
+#include "journal.h"
+
+#define F_CPU 8000000L
+#include <util/delay.h>
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Longest line that can be typed and the most numbers after a command
+#define LINE_SIZE 32
+#define MAX_ARGS 2
+// Column the typed line starts in (after the "> " prompt)
+#define LINE_COLUMN 3
+// The fine timer must advance this many 8us units (+/- 20%) across the
+// timer self test delay
+#define TEST_DELAY_MS 2
+#define TEST_FINE_TICKS (TEST_DELAY_MS * 125)
+
+typedef void (*CommandHandler)(uint8_t argc, uint16_t* args);
+
+typedef struct {
+	char name[8];
+	CommandHandler handler;
+} Command;
+
+static char line[LINE_SIZE + 1];
+static uint8_t length;
+static uint8_t service;
+// Row the next line of command output goes on
+static uint8_t output_row;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+
+static void run_line(void);
+static uint8_t parse_args(char* text, uint16_t* args);
+static void output_line(void);
+static void show_prompt(void);
+static void command_help(uint8_t argc, uint16_t* args);
+static void command_speed(uint8_t argc, uint16_t* args);
+static void command_pattern(uint8_t argc, uint16_t* args);
+static void command_level(uint8_t argc, uint16_t* args);
+static void command_lanes(uint8_t argc, uint16_t* args);
+static void command_timing(uint8_t argc, uint16_t* args);
+static void command_spi(uint8_t argc, uint16_t* args);
+static void command_serial(uint8_t argc, uint16_t* args);
+static void command_hsreset(uint8_t argc, uint16_t* args);
+static void command_test(uint8_t argc, uint16_t* args);
+static void command_bank(uint8_t argc, uint16_t* args);
+static void command_upload(uint8_t argc, uint16_t* args);
+static void command_volume(uint8_t argc, uint16_t* args);
+static void command_timers(uint8_t argc, uint16_t* args);
+static void command_idle(uint8_t argc, uint16_t* args);
+static void command_journal(uint8_t argc, uint16_t* args);
+
+// Commands in the order "help" lists them. "resume" is handled by run_line().
+static const Command commands[] PROGMEM = {
+	{"help", command_help},
+	{"speed", command_speed},
+	{"pattern", command_pattern},
+	{"level", command_level},
+	{"lanes", command_lanes},
+	{"timing", command_timing},
+	{"spi", command_spi},
+	{"serial", command_serial},
+	{"hsreset", command_hsreset},
+	{"test", command_test},
+	{"bank", command_bank},
+	{"upload", command_upload},
+	{"volume", command_volume},
+	{"timers", command_timers},
+	{"idle", command_idle},
+	{"journal", command_journal}
+};
+#define NUM_COMMANDS (sizeof(commands) / sizeof(commands[0]))
+
+// Colours the LED matrix self test fills the rows with
+static const PixelColour test_colours[] PROGMEM = {
+	COLOUR_RED, COLOUR_GREEN, COLOUR_YELLOW, COLOUR_ORANGE
+};
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+void console_open(uint8_t service_mode) {
+	service = service_mode;
+	length = 0;
+	show_prompt();
+	if(service) {
+		clear_report_area();
+		term_put_string_P(PSTR("Service mode - type resume to play"));
+	}
+}
+
+void console_close(void) {
+	service = 0;
+	length = 0;
+	move_cursor(1, CONSOLE_ROW);
+	clear_to_end_of_line();
+	// Don't leave command output behind on the game screen
+	clear_report_area();
+}
+
+uint8_t console_service(void) {
+	return service;
+}
+
+uint8_t console_key(uint8_t key) {
+	if(key == KEY_ENTER) {
+		line[length] = '\0';
+		if(strcmp_P(line, PSTR("resume")) == 0) {
+			return CONSOLE_RESUME;
+		}
+		run_line();
+		length = 0;
+		show_prompt();
+		return CONSOLE_USED;
+	}
+	if(key == KEY_BACKSPACE || key == 0x7F) {
+		if(length > 0) {
+			length--;
+			move_cursor(LINE_COLUMN + length, CONSOLE_ROW);
+			clear_to_end_of_line();
+		}
+		return CONSOLE_USED;
+	}
+	if(key < ' ' || key > '~') {
+		// A button, joystick direction or function key bound to pause
+		// resumes the game. Printable keys always go to the line so that
+		// commands starting with the pause key (e.g. "pattern") can be typed.
+		if(length == 0 && keymap_action(key) == ACTION_PAUSE && !service) {
+			return CONSOLE_RESUME;
+		}
+		return CONSOLE_IGNORED;
+	}
+	if(length < LINE_SIZE) {
+		line[length] = key;
+		move_cursor(LINE_COLUMN + length, CONSOLE_ROW);
+		serial_put_char(key);
+		length++;
+	}
+	return CONSOLE_USED;
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Runs the command on the line. The game is paused so it is safe to wait for
+// the terminal while the output is sent.
+static void run_line(void) {
+	uint16_t args[MAX_ARGS];
+	char* text = line;
+
+	while(*text == ' ') {
+		text++;
+	}
+	if(*text == '\0') {
+		return;
+	}
+	// Split the command name from its arguments
+	char* rest = text;
+	while(*rest != ' ' && *rest != '\0') {
+		rest++;
+	}
+	if(*rest != '\0') {
+		*rest++ = '\0';
+	}
+
+	clear_report_area();
+	output_row = CONSOLE_OUTPUT_ROW;
+	output_line();
+
+	uint8_t argc = parse_args(rest, args);
+	if(argc > MAX_ARGS) {
+		term_put_string_P(PSTR("Bad arguments: "));
+		term_put_string(rest);
+		return;
+	}
+	for(uint8_t i = 0; i < NUM_COMMANDS; i++) {
+		if(strcmp_P(text, commands[i].name) == 0) {
+			CommandHandler handler = (CommandHandler)pgm_read_word(
+					&commands[i].handler);
+			handler(argc, args);
+			return;
+		}
+	}
+	term_put_string_P(PSTR("Unknown command "));
+	term_put_string(text);
+	term_put_string_P(PSTR(" - try help"));
+}
+
+// Reads up to MAX_ARGS unsigned numbers separated by spaces. Returns the
+// number read or MAX_ARGS + 1 if the text isn't all numbers.
+static uint8_t parse_args(char* text, uint16_t* args) {
+	uint8_t argc = 0;
+
+	while(1) {
+		while(*text == ' ') {
+			text++;
+		}
+		if(*text == '\0') {
+			return argc;
+		}
+		if(argc == MAX_ARGS) {
+			return MAX_ARGS + 1;
+		}
+		uint16_t value = 0;
+		while(*text >= '0' && *text <= '9') {
+			value = value * 10 + (*text - '0');
+			text++;
+		}
+		if(*text != ' ' && *text != '\0') {
+			return MAX_ARGS + 1;
+		}
+		args[argc++] = value;
+	}
+}
+
+// Moves to the start of the next output row
+static void output_line(void) {
+	if(output_row <= REPORT_LAST_ROW) {
+		move_cursor(1, output_row++);
+	}
+}
+
+static void show_prompt(void) {
+	move_cursor(1, CONSOLE_ROW);
+	clear_to_end_of_line();
+	// "$" marks service mode
+	term_put_string_P(service ? PSTR("$ ") : PSTR("> "));
+}
+
+static void command_help(uint8_t argc, uint16_t* args) {
+	term_put_string_P(PSTR("Commands: resume"));
+	for(uint8_t i = 0; i < NUM_COMMANDS; i++) {
+		serial_put_char(' ');
+		serial_put_string_P(commands[i].name);
+	}
+	output_line();
+	term_put_string_P(PSTR("speed [row ms]  pattern [n]  level [n]  "
+			"spi [0]  bank [0]"));
+	output_line();
+	term_put_string_P(PSTR("volume [0-3]  timers [0]  idle [0]"));
+}
+
+// Shows the time between moves of each row or changes one of them
+static void command_speed(uint8_t argc, uint16_t* args) {
+	if(argc == 2) {
+		if(!set_row_speed(args[0], args[1])) {
+			term_put_string_P(PSTR("No row "));
+			term_put_unsigned(args[0], 0);
+			term_put_string_P(PSTR(" or speed 0"));
+			return;
+		}
+	} else if(argc != 0) {
+		term_put_string_P(PSTR("speed [row ms]"));
+		return;
+	}
+	term_put_string_P(PSTR("Row speeds (ms):"));
+	for(uint8_t row = FIRST_VEHICLE_ROW_SPEED;
+			row <= SECOND_RIVER_ROW_SPEED; row++) {
+		serial_put_char(' ');
+		term_put_unsigned(row, 0);
+		serial_put_char('=');
+		term_put_unsigned(get_row_speed(row), 0);
+	}
+}
+
+// Shows or changes the lane and log pattern. Patterns are numbered from 1.
+static void command_pattern(uint8_t argc, uint16_t* args) {
+	if(argc == 1 && (args[0] == 0 || !set_pattern(args[0] - 1))) {
+		term_put_string_P(PSTR("No pattern "));
+		term_put_unsigned(args[0], 0);
+		return;
+	}
+	term_put_string_P(PSTR("Pattern "));
+	term_put_unsigned(get_pattern() + 1, 0);
+}
+
+static void command_level(uint8_t argc, uint16_t* args) {
+	if(argc == 1) {
+		set_level(args[0]);
+	}
+	term_put_string_P(PSTR("Level "));
+	term_put_unsigned(get_level(), 0);
+}
+
+// Dumps the scroll positions of the lanes and logs and where the frog is
+static void command_lanes(uint8_t argc, uint16_t* args) {
+	term_put_string_P(PSTR("Lane positions:"));
+	for(uint8_t lane = 0; lane < LEVEL_NUM_LANES; lane++) {
+		serial_put_char(' ');
+		term_put_unsigned(get_lane_position(lane), 0);
+	}
+	output_line();
+	term_put_string_P(PSTR("Log positions:"));
+	for(uint8_t channel = 0; channel < LEVEL_NUM_CHANNELS; channel++) {
+		serial_put_char(' ');
+		term_put_unsigned(get_log_position(channel), 0);
+	}
+	output_line();
+	term_put_string_P(PSTR("Frog at column "));
+	term_put_unsigned(get_frog_column(), 0);
+	term_put_string_P(PSTR(" row "));
+	term_put_unsigned(get_frog_row(), 0);
+	if(is_frog_dead()) {
+		term_put_string_P(PSTR(" (dead)"));
+	}
+}
+
+// Shows the clocks and the input latency summary
+static void command_timing(uint8_t argc, uint16_t* args) {
+	LatencyStats stats;
+
+	term_put_string_P(PSTR("Clock "));
+	term_put_unsigned(get_current_time(), 0);
+	term_put_string_P(PSTR(" ms  fine "));
+	term_put_unsigned(get_fine_time(), 0);
+	term_put_string_P(PSTR("  countdown "));
+	term_put_unsigned(get_countdown(), 0);
+	term_put_string_P(PSTR("0 ms"));
+	output_line();
+	latency_get_stats(&stats);
+	term_put_string_P(PSTR("Latency "));
+	term_put_unsigned(stats.samples, 0);
+	term_put_string_P(PSTR(" samples  min "));
+	term_put_unsigned(stats.min, 0);
+	term_put_string_P(PSTR("  avg "));
+	term_put_unsigned(stats.average, 0);
+	term_put_string_P(PSTR("  max "));
+	term_put_unsigned(stats.max, 0);
+	term_put_string_P(PSTR(" (8us)"));
+}
+
+// Shows how much LED matrix data has been sent and how long was spent waiting
+// for it. "spi 0" clears the counters.
+static void command_spi(uint8_t argc, uint16_t* args) {
+	uint32_t bytes, polls;
+
+	spi_get_counters(&bytes, &polls);
+	term_put_string_P(PSTR("SPI "));
+	term_put_unsigned(bytes, 0);
+	term_put_string_P(PSTR(" bytes  "));
+	term_put_unsigned(polls, 0);
+	term_put_string_P(PSTR(" wait polls"));
+	if(argc == 1 && args[0] == 0) {
+		spi_clear_counters();
+		term_put_string_P(PSTR(" - cleared"));
+	}
+}
+
+static void command_serial(uint8_t argc, uint16_t* args) {
+	serial_report();
+}
+
+static void command_hsreset(uint8_t argc, uint16_t* args) {
+	reset_highscores();
+	term_put_string_P(PSTR("Highscores cleared"));
+}
+
+// Fills the LED matrix with coloured rows (left there until the game is
+// resumed) and checks the timer and EEPROM
+static void command_test(uint8_t argc, uint16_t* args) {
+	MatrixRow row;
+	uint32_t bytes_before, bytes_after, polls;
+
+	spi_get_counters(&bytes_before, &polls);
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		set_matrix_row_to_colour(row, pgm_read_byte(&test_colours[y % 4]));
+		ledmatrix_update_row(y, row);
+	}
+	spi_get_counters(&bytes_after, &polls);
+	term_put_string_P(PSTR("LED matrix: "));
+	term_put_unsigned(bytes_after - bytes_before, 0);
+	term_put_string_P(PSTR(" bytes sent - check the rows are "
+			"red, green, yellow, orange"));
+	output_line();
+
+	uint16_t start = get_fine_time();
+	_delay_ms(TEST_DELAY_MS);
+	uint16_t elapsed = get_fine_time() - start;
+	term_put_string_P(PSTR("Timer: "));
+	term_put_unsigned(elapsed, 0);
+	term_put_string_P(PSTR(" of "));
+	term_put_unsigned(TEST_FINE_TICKS, 0);
+	term_put_string_P((elapsed > TEST_FINE_TICKS * 4 / 5 &&
+			elapsed < TEST_FINE_TICKS * 6 / 5) ? PSTR(" fine ticks - pass") :
+			PSTR(" fine ticks - FAIL"));
+	output_line();
+
+	term_put_string_P(journal_check() ? PSTR("Journal EEPROM: pass") :
+			PSTR("Journal EEPROM: FAIL"));
+}
+
+// Shows how many patterns the level bank holds. "bank 0" throws it away.
+static void command_bank(uint8_t argc, uint16_t* args) {
+	if(argc == 1 && args[0] == 0) {
+		levelbank_clear();
+		reload_pattern();
+	}
+	if(levelbank_count() == 0) {
+		term_put_string_P(PSTR("No level bank - "));
+		term_put_unsigned(get_num_patterns(), 0);
+		term_put_string_P(PSTR(" built in patterns"));
+	} else {
+		term_put_string_P(PSTR("Level bank of "));
+		term_put_unsigned(levelbank_count(), 0);
+		term_put_string_P(PSTR(" patterns"));
+	}
+}
+
+// Waits for tools/level_upload.py to send a level bank
+static void command_upload(uint8_t argc, uint16_t* args) {
+	levelbank_start_upload();
+	term_put_string_P(PSTR("Waiting for upload - push a button to cancel"));
+}
+
+// Shows or sets the volume (0 is off, 3 is loudest)
+static void command_volume(uint8_t argc, uint16_t* args) {
+	if(argc == 1) {
+		if(args[0] >= NUM_VOLUMES) {
+			term_put_string_P(PSTR("No volume "));
+			term_put_unsigned(args[0], 0);
+			return;
+		}
+		set_volume(args[0]);
+	}
+	term_put_string_P(PSTR("Volume "));
+	term_put_unsigned(get_volume(), 0);
+}
+
+// Lists the soft timers in priority order with how long their callbacks take.
+// "timers 0" clears the figures.
+static void command_timers(uint8_t argc, uint16_t* args) {
+	SoftTimerStats stats;
+
+	term_put_string_P(PSTR("Timer      period  runs   avg us  max us"));
+	for(uint8_t i = 0; i < softtimer_count(); i++) {
+		softtimer_get_stats(i, &stats);
+		output_line();
+		// Names are padded to 10 characters
+		term_put_string_P(stats.name);
+		for(uint8_t n = strlen_P(stats.name); n < 11; n++) {
+			serial_put_char(' ');
+		}
+		term_put_unsigned(stats.period, 4);
+		serial_put_char((stats.flags & SOFTTIMER_DEFERRED) ? '*' : ' ');
+		term_put_unsigned(stats.runs, 7);
+		term_put_unsigned(stats.average * 8, 8);
+		term_put_unsigned(stats.max * 8, 8);
+	}
+	output_line();
+	term_put_string_P(PSTR("* run from the main loop"));
+	if(argc == 1 && args[0] == 0) {
+		softtimer_clear_stats();
+		term_put_string_P(PSTR(" - cleared"));
+	}
+}
+
+// Shows how much of the time the processor sleeps and what wakes it.
+// "idle 0" clears the figures.
+static void command_idle(uint8_t argc, uint16_t* args) {
+	IdleStats stats;
+
+	idle_get_stats(&stats);
+	uint32_t total = stats.asleep + stats.awake;
+	term_put_string_P(PSTR("Asleep "));
+	term_put_unsigned(total >= 100 ? stats.asleep / (total / 100) : 0, 0);
+	term_put_string_P(PSTR("% of "));
+	term_put_unsigned(total / 125, 0);
+	term_put_string_P(PSTR(" ms  "));
+	term_put_unsigned(stats.sleeps, 0);
+	term_put_string_P(PSTR(" sleeps"));
+	output_line();
+	term_put_string_P(PSTR("Woken by timer "));
+	term_put_unsigned(stats.wakes[IDLE_WAKE_TIMER], 0);
+	term_put_string_P(PSTR("  rx "));
+	term_put_unsigned(stats.wakes[IDLE_WAKE_SERIAL_RX], 0);
+	term_put_string_P(PSTR("  tx "));
+	term_put_unsigned(stats.wakes[IDLE_WAKE_SERIAL_TX], 0);
+	term_put_string_P(PSTR("  eeprom "));
+	term_put_unsigned(stats.wakes[IDLE_WAKE_EEPROM], 0);
+	term_put_string_P(PSTR("  other "));
+	term_put_unsigned(stats.wakes[IDLE_WAKE_OTHER], 0);
+	if(argc == 1 && args[0] == 0) {
+		idle_clear_stats();
+		term_put_string_P(PSTR(" - cleared"));
+	}
+}
+
+// Shows how full the EEPROM journal is and how much it has been written
+static void command_journal(uint8_t argc, uint16_t* args) {
+	JournalStats stats;
+
+	journal_get_stats(&stats);
+	term_put_string_P(PSTR("Journal "));
+	term_put_unsigned(JOURNAL_SLOTS, 0);
+	term_put_string_P(PSTR(" slots  "));
+	term_put_unsigned(stats.live, 0);
+	term_put_string_P(PSTR(" records  "));
+	term_put_unsigned(stats.free, 0);
+	term_put_string_P(PSTR(" free  next sequence "));
+	term_put_unsigned(stats.sequence, 0);
+	output_line();
+	term_put_string_P(PSTR("Since reset "));
+	term_put_unsigned(stats.writes, 0);
+	term_put_string_P(PSTR(" saved  "));
+	term_put_unsigned(stats.copies, 0);
+	term_put_string_P(PSTR(" copied forward  "));
+	term_put_unsigned(stats.skipped, 0);
+	term_put_string_P(PSTR(" unchanged"));
+}
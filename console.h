@@ -0,0 +1,56 @@
+/*
+* console.h
+*
+* A line based command console on the serial terminal for looking at and
+* changing the game while it is paused. Keys are fed in one at a time from
+* the main loop so the console never waits for input. Type "help" for the
+* list of commands.
+*
+*Author: Michael Bossner
+*/
+
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <stdint.h>
+
+#include "terminalio.h"
+
+// Terminal row of the console prompt. Command output is printed in the
+// report area (see clear_report_area()), which it shares with the latency
+// and serial reports.
+#define CONSOLE_ROW 12
+#define CONSOLE_OUTPUT_ROW REPORT_FIRST_ROW
+
+// What console_key() did with a key
+#define CONSOLE_IGNORED 0
+#define CONSOLE_USED 1
+#define CONSOLE_RESUME 2
+
+/*
+ * Shows the prompt. In service mode (service non-zero) the game can only be
+ * resumed with the "resume" command. Otherwise any key that isn't part of a
+ * command resumes it. Printable keys are always part of a command, even
+ * the one bound to pause.
+ */
+void console_open(uint8_t service);
+
+/*
+ * Removes the prompt.
+ */
+void console_close(void);
+
+/*
+ * Returns non-zero while the console is open in service mode.
+ */
+uint8_t console_service(void);
+
+/*
+ * Handles a key while the console is open. Printable keys, backspace and
+ * enter are used by the console, enter runs the line typed. Returns
+ * CONSOLE_RESUME if the game should be resumed, CONSOLE_IGNORED if the key
+ * wasn't used and CONSOLE_USED otherwise.
+ */
+uint8_t console_key(uint8_t key);
+
+#endif /* CONSOLE_H_ */
@@ -1,135 +1,192 @@
-/*
-* countdown.c
-*
-* Author: Michael Bossner
-*/
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <avr/pgmspace.h>
-#include <stdio.h>
-
-#include "countdown.h"
-#include "serialio.h"
-#include "terminalio.h"
-#include "game.h"
-#include "audio.h"
-#include "joystick.h"
-
-////////////////////////////// Global variables ///////////////////////////////
-
-// SSD Digigts 0 through to 9 represented as hex numbers
-static uint16_t SSD_digits[10] = {
-	0x3F,
-	0x06,
-	0x5B,
-	0x4F,
-	0x66,
-	0x6D,
-	0x7D,
-	0x07,
-	0x7F,
-	0x6F,
-};
-
-// Countdown clock
-static volatile uint16_t countdown;
-// Pause Flag
-static uint8_t pause;
-// SSD_CC for changing between the 2 SSD displays
-static volatile uint8_t ssd_cc;
-// start time for the Countdown (10000 = 10sec)
-#define TIME_LIMIT 2000
-
-/////////////////// Function Prototypes for Helper Functions ///////////////////
-static void update_countdown(void);
-
-/////////////////////////////// Public Functions ///////////////////////////////
-
-// initilises the countdown for use during the game
-void init_countdown(void) {
-	countdown = TIME_LIMIT;
-	pause = FALSE;
-
-	// clear timer
-	TCNT2 = 0;
-	// set 10ms ticks
-	OCR2A = 77;
-	// CTC mode
-	TCCR2A = (1<<WGM21);
-	TCCR2B = (1<<CS21) | (1<<CS20) | (1<<CS22);
-	// sets interrupts for every 10ms
-	TIMSK2 |= (1<<OCIE2A);
-	// clears the interrupt flag
-	TIFR2 &= (1<<OCF2A);
-
-	// Set all of Port C as an output
-	DDRC = 0xFF;
-	DDRA |= (1<<DDRA7);
-}
-
-// resets the countdown
-void reset_countdown(void) {
-	countdown = TIME_LIMIT;
-	TCNT1 = 0;
-	pause = FALSE;
-}
-
-// Sets the pause flag.
-// Resets the interrupt flag is unpaused.
-void pause_countdown(uint8_t set) {
-	pause = set;
-	if(!pause) {
-		TIFR1 = (1<<OCF1A);
-	}
-}
-
-/////////////////////////////// Private (Helper) Functions /////////////////////
-
-// Updates the SSD displays with the correct digits for the countdown
-// Also sets the frog to dead if the countdown reaches 0
-static void update_countdown(void) {
-	if(countdown >= 1000) {
-		if(ssd_cc) {
-			PORTC = SSD_digits[(countdown/1000)%10];
-			} else {
-			PORTC = SSD_digits[(countdown/100)%10];
-		}
-	}
-	else if(countdown >= 100) {
-		if(ssd_cc) {
-			PORTC = 0x00;
-			} else {
-			PORTC = SSD_digits[(countdown/100)%10];
-		}
-	}
-	else {
-		if(ssd_cc) {
-			PORTC = 0xBF;
-			} else {
-			PORTC = SSD_digits[(countdown/10)%10];
-		}
-	}
-
-	if(countdown <= 0 && get_frog_row() != 7) {
-		set_frog_dead(TRUE);
-	}
-}
-
-// Timer interupt set to go off every 10ms.
-// Checks for a joystick move and updates the countdown.
-// I used this timer for the joystick check as it fires less often then the main
-// timer.
-ISR(TIMER2_COMPA_vect) {
-	if(!pause) {
-		countdown--;
-		joystick_move();
-	}
-	ssd_cc = 0x80 ^ ssd_cc;
-	if(ssd_cc) {
-		PORTA ^= 0b10000000;
-	} else {
-		PORTA &= 0b01111111;
-	}
-	update_countdown();
-}
\ No newline at end of file
+/*
+* countdown.c
+*
+* Author: Michael Bossner
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+
+#include "countdown.h"
+#include "serialio.h"
+#include "terminalio.h"
+#include "game.h"
+#include "audio.h"
+#include "softtimer.h"
+
+////////////////////////////// Global variables ///////////////////////////////
+
+// Segments lit for the digits 0 through to 9
+static const uint8_t SSD_digits[10] PROGMEM = {
+	0x3F,
+	0x06,
+	0x5B,
+	0x4F,
+	0x66,
+	0x6D,
+	0x7D,
+	0x07,
+	0x7F,
+	0x6F,
+};
+#define SSD_BLANK 0x00
+#define SSD_POINT 0x80
+
+// Converts a number from 0 to 99 to packed BCD when compiling
+#define BCD(n) ((((n) / 10) << 4) | ((n) % 10))
+
+// Countdown clock as 4 packed BCD digits - tens of seconds, seconds, tenths
+// and hundredths. It is counted down a digit at a time so it never has to be
+// divided up to be shown.
+static volatile uint16_t countdown;
+// start time for the Countdown
+#define TIME_LIMIT (BCD(COUNTDOWN_SECONDS) << 8)
+// Segments to show on the right (0) and left (1) SSD. They only change when
+// the countdown does.
+static volatile uint8_t segments[2];
+// SSD_CC for changing between the 2 SSD displays (0 or SSD_CC_PIN)
+static volatile uint8_t ssd_cc;
+#define SSD_CC_PIN (1<<PORTA7)
+// Time (ms) between countdown ticks and SSD display changes
+#define COUNTDOWN_PERIOD 10
+
+// Soft timers (see init_countdown()). They are registered the first time a
+// game starts.
+static int8_t countdown_timer = -1;
+static int8_t expired_timer = -1;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+static void update_segments(void);
+static void countdown_tick(void);
+static void display_tick(void);
+static void countdown_expired(void);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// initilises the countdown for use during the game. The countdown is counted
+// down by one soft timer and shown on the SSD by another that keeps running
+// while the game is paused. Killing the frog when time runs out is left to the
+// main loop.
+void init_countdown(void) {
+	if(countdown_timer < 0) {
+		countdown_timer = softtimer_add(countdown_tick, COUNTDOWN_PERIOD,
+				SOFTTIMER_PRIORITY_NORMAL, 0, PSTR("countdown"));
+		softtimer_add(display_tick, COUNTDOWN_PERIOD,
+				SOFTTIMER_PRIORITY_LOW, 0, PSTR("ssd"));
+		expired_timer = softtimer_add(countdown_expired, 1,
+				SOFTTIMER_PRIORITY_NORMAL,
+				SOFTTIMER_ONESHOT | SOFTTIMER_DEFERRED, PSTR("expired"));
+	}
+	reset_countdown();
+
+	// Set all of Port C as an output
+	DDRC = 0xFF;
+	DDRA |= (1<<DDRA7);
+}
+
+// resets the countdown. The next tick is a full 10ms away.
+void reset_countdown(void) {
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	countdown = TIME_LIMIT;
+	update_segments();
+	if(interrupts_were_enabled) {
+		sei();
+	}
+	softtimer_start(countdown_timer, COUNTDOWN_PERIOD);
+	softtimer_hold(countdown_timer, FALSE);
+}
+
+// Holds the countdown timer. The time left until its next tick is kept so the
+// countdown carries on from the same point when unpaused.
+void pause_countdown(uint8_t set) {
+	softtimer_hold(countdown_timer, set);
+}
+
+// Returns the countdown. It is changed by the timer interrupt so interrupts
+// are turned off while it is read. The BCD digits are converted to binary
+// here rather than in the interrupt handler.
+uint16_t get_countdown(void) {
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	uint16_t bcd = countdown;
+	if(interrupts_were_enabled) {
+		sei();
+	}
+	uint16_t return_value = 0;
+	for(int8_t shift = 12; shift >= 0; shift -= 4) {
+		return_value = return_value * 10 + ((bcd >> shift) & 0x0F);
+	}
+	return return_value;
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Works out the segments for the SSDs from the countdown digits. The seconds
+// are shown without a leading zero. Below COUNTDOWN_TENTHS_BELOW seconds the
+// seconds digit gets a decimal point and the tenths are shown after it.
+static void update_segments(void) {
+	uint8_t seconds = countdown >> 8;
+	uint8_t tenths = (countdown >> 4) & 0x0F;
+
+	if(seconds < BCD(COUNTDOWN_TENTHS_BELOW)) {
+		segments[1] = pgm_read_byte(&SSD_digits[seconds & 0x0F]) | SSD_POINT;
+		segments[0] = pgm_read_byte(&SSD_digits[tenths]);
+	} else {
+		segments[1] = (seconds >> 4) ?
+				pgm_read_byte(&SSD_digits[seconds >> 4]) : SSD_BLANK;
+		segments[0] = pgm_read_byte(&SSD_digits[seconds & 0x0F]);
+	}
+}
+
+// Called by a soft timer every 10ms while the countdown isn't paused. When
+// the countdown runs out the frog is killed from the main loop.
+//
+// Taking 1 from the packed digits borrows from each 0 digit at the bottom,
+// which leaves those digits as 0xF instead of 9 - so 6 is taken from each of
+// them as well. The SSD segments only need working out when the tenths
+// change.
+static void countdown_tick(void) {
+	uint16_t digits = countdown;
+	if(!digits) {
+		return;
+	}
+	uint16_t result = digits - 1;
+	uint16_t six = 0x0006;
+	while(!(digits & 0x000F)) {
+		result -= six;
+		six <<= 4;
+		digits >>= 4;
+	}
+	countdown = result;
+
+	if(six != 0x0006) {
+		update_segments();
+	}
+	if(result == 0) {
+		softtimer_start(expired_timer, 1);
+	}
+}
+
+// Called by a soft timer every 10ms, even while paused. Changes between the
+// SSD displays and shows the segments worked out by update_segments().
+static void display_tick(void) {
+#if COUNTDOWN_DIGITS == 2
+	ssd_cc ^= SSD_CC_PIN;
+	PORTA = (PORTA & ~SSD_CC_PIN) | ssd_cc;
+	PORTC = segments[ssd_cc ? 1 : 0];
+#else
+	PORTC = segments[0];
+#endif
+}
+
+// Run from the main loop once the countdown has run out. The countdown may
+// have been reset since then, and a frog that has reached the riverbank is
+// safe.
+static void countdown_expired(void) {
+	if(get_countdown() == 0 && get_frog_row() != 7) {
+		set_frog_dead(TRUE);
+	}
+}
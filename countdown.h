@@ -1,29 +1,44 @@
-/*
-* countdown.h
-*
-* Functions for the countdown timer in the game.
-*
-* Author: Michael Bossner
-*/
-
-#ifndef COUNTDOWN_H_
-#define COUNTDOWN_H_
-
-#include <stdint.h>
-
-/*
- * Initilises the countdown for use in the game
- */
-void init_countdown(void);
-
-/*
- * Resets the countdown back to the time limit given
- */
-void reset_countdown(void);
-
-/*
- * Pauses the countdown. set=1 to pause and set=0 to unpause.
- */
-void pause_countdown(uint8_t set);
-
+/*
+* countdown.h
+*
+* Functions for the countdown timer in the game.
+*
+* Author: Michael Bossner
+*/
+
+#ifndef COUNTDOWN_H_
+#define COUNTDOWN_H_
+
+#include <stdint.h>
+
+// Time limit in seconds (1 to 99)
+#define COUNTDOWN_SECONDS 20
+// Number of seven segment displays the countdown is shown on (1 or 2). With
+// 1 only the right hand digit is shown.
+#define COUNTDOWN_DIGITS 2
+// Below this many seconds (0 to 10) the countdown is shown as the seconds
+// with a decimal point followed by the tenths. 0 always shows whole seconds.
+#define COUNTDOWN_TENTHS_BELOW 1
+
+/*
+ * Initilises the countdown for use in the game
+ */
+void init_countdown(void);
+
+/*
+ * Resets the countdown back to the time limit given
+ */
+void reset_countdown(void);
+
+/*
+ * Pauses the countdown. set=1 to pause and set=0 to unpause. The countdown
+ * carries on from the same point within its 10ms tick when unpaused.
+ */
+void pause_countdown(uint8_t set);
+
+/*
+ * Returns the time left on the countdown in 10ms ticks
+ */
+uint16_t get_countdown(void);
+
 #endif
\ No newline at end of file
@@ -1,367 +1,363 @@
-/*
-* highscore.c
-*
-* Author: Michael Bossner
-*/
-
-#include <avr/io.h>
-#include <avr/eeprom.h>
-#include <avr/pgmspace.h>
-#include <stdio.h>
-#include <ctype.h>
-
-#include "highscore.h"
-#include "terminalio.h"
-#include "audio.h"
-#include "score.h"
-#include "level.h"
-#include "game.h"
-#include "serialio.h"
-
-////////////////////////////// Global variables ////////////////////////////////
-
-// X/Y coordinates for the start and end of the highscore area
-#define START_POS_X 23
-#define END_POS_X 57
-#define START_POS_Y 5
-#define END_POS_Y 23
-// X Axis placement of the Columns
-#define RANK START_POS_X + 3
-#define SCORE START_POS_X + 13
-#define NAME START_POS_X + 22
-// Y Axis placement of the Rows
-#define CELL START_POS_Y + 4
-#define RANK1 START_POS_Y + 6
-#define RANK2 START_POS_Y + 8
-#define RANK3 START_POS_Y + 10
-#define RANK4 START_POS_Y + 12
-#define RANK5 START_POS_Y + 14
-#define INPUT_NAME_X END_POS_X + 5
-#define INPUT_NAME_Y START_POS_Y + 7
-
-// Left cursor ascii value
-#define LEFT_CURSOR 68
-// Escape Character ascii value
-#define ESCAPE_CHAR 27
-// Enter key ascii value
-#define ENTER 10
-// SpaceBar key ascii value
-#define SPACE 32
-// No input has been provided
-#define NO_INPUT -1
-
-// Signature for checking if the data is ours
-#define SIGNITURE 44277196
-static uint32_t EEMEM signiture;
-
-// Max characters allowed in a high score name
-#define MAX_NAME_SIZE 11
-// What is placed if there is no name available
-#define NO_NAME "NO NAME"
-// What is placed if there is no score available
-#define NO_SCORE 0
-
-// Memory is assigned for all high score data
-static uint8_t EEMEM rank1_name[MAX_NAME_SIZE];
-static uint8_t EEMEM rank2_name[MAX_NAME_SIZE];
-static uint8_t EEMEM rank3_name[MAX_NAME_SIZE];
-static uint8_t EEMEM rank4_name[MAX_NAME_SIZE];
-static uint8_t EEMEM rank5_name[MAX_NAME_SIZE];
-static uint32_t EEMEM rank1_score;
-static uint32_t EEMEM rank2_score;
-static uint32_t EEMEM rank3_score;
-static uint32_t EEMEM rank4_score;
-static uint32_t EEMEM rank5_score;
-
-// input variables
-static char serial_input, escape_sequence_char;
-static uint8_t characters_into_escape_sequence = NO_INPUT;
-// The name that is input for a highscore winner
-static uint8_t name_input[MAX_NAME_SIZE];
-// Game Over flag
-static uint8_t gameover_flag;
-
-/////////////////// Function Prototypes for Helper Functions ///////////////////
-
-static void terminal_draw_border(void);
-static void input_highscore(void);
-static void process_serial_in(void);
-
-/////////////////////////////// Public Functions ///////////////////////////////
-
-// Initialises the hardware for high score use. If the hardware has not already
-// been initialised before then space will be allocated and readied for use in the
-// future.
-void init_highscore(void) {
-	uint32_t temp = eeprom_read_dword(&signiture);
-	if(temp != SIGNITURE) {
-		// EEPROM not initalised for highscores
-		// sets the signiture for the EEPROM memory
-		eeprom_update_dword(&signiture, (uint32_t)SIGNITURE);
-		// set all names to "NO NAME"
-		eeprom_update_block((const void*)NO_NAME, (void*)rank1_name, MAX_NAME_SIZE);
-		eeprom_update_block((const void*)NO_NAME, (void*)rank2_name, MAX_NAME_SIZE);
-		eeprom_update_block((const void*)NO_NAME, (void*)rank3_name, MAX_NAME_SIZE);
-		eeprom_update_block((const void*)NO_NAME, (void*)rank4_name, MAX_NAME_SIZE);
-		eeprom_update_block((const void*)NO_NAME, (void*)rank5_name, MAX_NAME_SIZE);
-		// set all highscores to 0
-		eeprom_update_dword(&rank1_score, (uint32_t)NO_SCORE);
-		eeprom_update_dword(&rank2_score, (uint32_t)NO_SCORE);
-		eeprom_update_dword(&rank3_score, (uint32_t)NO_SCORE);
-		eeprom_update_dword(&rank4_score, (uint32_t)NO_SCORE);
-		eeprom_update_dword(&rank5_score, (uint32_t)NO_SCORE);
-	}
-}
-
-// Draws the highscore screen to the terminal and collects all highscores from
-// memory and displayes it. If the game_over flag has been set and a highscore
-// achieved input will be requested by the user for the new highscore.
-void draw_highscore_screen(void) {
-	terminal_draw_border();
-
-	// Temporary variables to hold the highscore data from memory
-	uint8_t temp_rank1_name[MAX_NAME_SIZE];
-	uint8_t temp_rank2_name[MAX_NAME_SIZE];
-	uint8_t temp_rank3_name[MAX_NAME_SIZE];
-	uint8_t temp_rank4_name[MAX_NAME_SIZE];
-	uint8_t temp_rank5_name[MAX_NAME_SIZE];
-	eeprom_read_block((void*)temp_rank1_name,(const void*)rank1_name,MAX_NAME_SIZE);
-	eeprom_read_block((void*)temp_rank2_name,(const void*)rank2_name,MAX_NAME_SIZE);
-	eeprom_read_block((void*)temp_rank3_name,(const void*)rank3_name,MAX_NAME_SIZE);
-	eeprom_read_block((void*)temp_rank4_name,(const void*)rank4_name,MAX_NAME_SIZE);
-	eeprom_read_block((void*)temp_rank5_name,(const void*)rank5_name,MAX_NAME_SIZE);
-
-	uint32_t temp_rank1_score = eeprom_read_dword(&rank1_score);
-	uint32_t temp_rank2_score = eeprom_read_dword(&rank2_score);
-	uint32_t temp_rank3_score = eeprom_read_dword(&rank3_score);
-	uint32_t temp_rank4_score = eeprom_read_dword(&rank4_score);
-	uint32_t temp_rank5_score = eeprom_read_dword(&rank5_score);
-
-	// draws the words that will always be displayed during a highscore screen
-	move_cursor(START_POS_X +13 ,START_POS_Y+2);
-	printf_P(PSTR("Highscore"));
-
-	move_cursor(RANK,CELL);
-	printf_P(PSTR(" Rank"));
-	move_cursor(SCORE,CELL);
-	printf_P(PSTR("Score"));
-	move_cursor(NAME,CELL);
-	printf_P(PSTR("   Name"));
-
-	set_display_attribute(FG_YELLOW);
-	move_cursor(RANK,RANK1);
-	printf_P(PSTR("  1  "));
-	move_cursor(RANK,RANK2);
-	printf_P(PSTR("  2 "));
-	move_cursor(RANK,RANK3);
-	printf_P(PSTR("  3 "));
-	move_cursor(RANK,RANK4);
-	printf_P(PSTR("  4  "));
-	move_cursor(RANK,RANK5);
-	printf_P(PSTR("  5 "));
-
-	// Checks memory for current highscores if no highscore exists the space
-	// will be left blank.
-	if(temp_rank1_score != NO_SCORE) {
-		set_display_attribute(FG_RED);
-		move_cursor(SCORE,RANK1);
-		printf_P(PSTR(" %u"), temp_rank1_score);
-
-		set_display_attribute(FG_CYAN);
-		move_cursor(NAME,RANK1);
-		printf_P(PSTR("%s"), temp_rank1_name);
-	}
-	if(temp_rank2_score != NO_SCORE) {
-		set_display_attribute(FG_RED);
-		move_cursor(SCORE,RANK2);
-		printf_P(PSTR(" %u"), temp_rank2_score);
-
-		set_display_attribute(FG_CYAN);
-		move_cursor(NAME,RANK2);
-		printf_P(PSTR("%s"), temp_rank2_name);
-	}
-	if(temp_rank3_score != NO_SCORE) {
-		set_display_attribute(FG_RED);
-		move_cursor(SCORE,RANK3);
-		printf_P(PSTR(" %u"), temp_rank3_score);
-		set_display_attribute(FG_CYAN);
-		move_cursor(NAME,RANK3);
-		printf_P(PSTR("%s"), temp_rank3_name);
-	}
-	if(temp_rank4_score != NO_SCORE) {
-		set_display_attribute(FG_RED);
-		move_cursor(SCORE,RANK4);
-		printf_P(PSTR(" %u"), temp_rank4_score);
-		set_display_attribute(FG_CYAN);
-		move_cursor(NAME,RANK4);
-		printf_P(PSTR("%s"), temp_rank4_name);
-	}
-	if(temp_rank5_score != NO_SCORE) {
-		set_display_attribute(FG_RED);
-		move_cursor(SCORE,RANK5);
-		printf_P(PSTR(" %u"), temp_rank5_score);
-		set_display_attribute(FG_CYAN);
-		move_cursor(NAME,RANK5);
-		printf_P(PSTR("%s"), temp_rank5_name);
-	}
-	set_display_attribute(FG_GREEN);
-
-	// Checks if a highscore has been achieved and adds it to memory and
-	// displays it.
-	if(gameover_flag == TRUE) {
-		if(get_score() > temp_rank1_score) {
-			input_highscore();
-			eeprom_update_dword(&rank1_score, (uint32_t)get_score());
-			eeprom_update_block((const void*)name_input,&rank1_name,MAX_NAME_SIZE);
-			move_cursor(RANK,RANK1);
-			clear_to_end_of_line();
-		}
-		else if(get_score() > temp_rank2_score) {
-			input_highscore();
-			eeprom_update_dword(&rank2_score, (uint32_t)get_score());
-			eeprom_update_block((const void*)name_input,&rank2_name,MAX_NAME_SIZE);
-			move_cursor(RANK,RANK2);
-			clear_to_end_of_line();
-		}
-		else if(get_score() > temp_rank3_score) {
-			input_highscore();
-			eeprom_update_dword(&rank3_score, (uint32_t)get_score());
-			eeprom_update_block((const void*)name_input,&rank3_name,MAX_NAME_SIZE);
-			move_cursor(RANK,RANK3);
-			clear_to_end_of_line();
-		}
-		else if(get_score() > temp_rank4_score) {
-			input_highscore();
-			eeprom_update_dword(&rank4_score, (uint32_t)get_score());
-			eeprom_update_block((const void*)name_input,&rank4_name,MAX_NAME_SIZE);
-			move_cursor(RANK,RANK4);
-			clear_to_end_of_line();
-		}
-		else if(get_score() > temp_rank5_score) {
-			input_highscore();
-			eeprom_update_dword(&rank5_score, (uint32_t)get_score());
-			eeprom_update_block((const void*)name_input,&rank5_name,MAX_NAME_SIZE);
-			move_cursor(RANK,RANK5);
-			clear_to_end_of_line();
-		}
-		gameover_flag = FALSE;
-		draw_highscore_screen();
-	}
-}
-
-// Draws stats to the game over screen and sets the gameover_flag.
-// Also calls draw_highscore_screen()
-void draw_gameover_screen(void) {
-	gameover_flag = TRUE;
-	move_cursor(1,START_POS_Y+4);
-	printf_P(PSTR("Score: %u"), get_score());
-	move_cursor(1,START_POS_Y+6);
-	printf_P(PSTR("level: %u"), get_level());
-	draw_highscore_screen();
-}
-
-/////////////////////////////// Private (Helper) Functions /////////////////////
-
-// Draws the border for the highscore screen
-static void terminal_draw_border(void) {
-	// Top horizontal border line
-	set_display_attribute(FG_MAGENTA);
-	draw_horizontal_line(START_POS_Y, START_POS_X, END_POS_X);
-	// Bottom horizontal border line
-	set_display_attribute(FG_MAGENTA);
-	draw_horizontal_line(END_POS_Y, START_POS_X, END_POS_X);
-	// Left vertical border line
-	set_display_attribute(FG_MAGENTA);
-	draw_vertical_line(START_POS_X, START_POS_Y, END_POS_Y);
-	// Right vertical border line
-	set_display_attribute(FG_MAGENTA);
-	draw_vertical_line(END_POS_X, START_POS_Y, END_POS_Y);
-	set_display_attribute(FG_GREEN);
-}
-
-// Controls the logic for inputing a high score winners name
-static void input_highscore(void) {
-	// clears name_input
-	for(uint8_t i = 0; i<MAX_NAME_SIZE; i++) {
-		name_input[i] = 0;
-	}
-
-	move_cursor(END_POS_X+5, START_POS_Y+4);
-	printf_P(PSTR("NEW HIGH SCORE!!"));
-	move_cursor(END_POS_X+5, START_POS_Y+6);
-	printf_P(PSTR("Enter a name"));
-	move_cursor(INPUT_NAME_X, INPUT_NAME_Y);
-	show_cursor();
-
-	uint8_t i = 0;
-	while(1) {
-		if(serial_input_available()) {
-			
-			set_display_attribute(FG_CYAN);
-			process_serial_in();
-			
-			if(serial_input == ENTER) {
-				break;
-			}
-			else if(((serial_input == SPACE) ||
-			(serial_input >= 65 && serial_input <= 90) ||
-			(serial_input >= 97 && serial_input <= 122)) &&
-			(i < 10)) {
-				name_input[i] = serial_input;
-				i++;
-				move_cursor(INPUT_NAME_X, INPUT_NAME_Y);
-				printf_P(PSTR("%s"), name_input);
-				move_cursor(INPUT_NAME_X+i, INPUT_NAME_Y);
-				clear_to_end_of_line();
-			}
-			else if((escape_sequence_char == LEFT_CURSOR) && (i > 0)) {
-				i--;
-				name_input[i] = 0;
-				move_cursor(INPUT_NAME_X, INPUT_NAME_Y);
-				printf_P(PSTR("%s"), name_input);
-				move_cursor(INPUT_NAME_X+i, INPUT_NAME_Y);
-				clear_to_end_of_line();
-			}
-			serial_input = NO_INPUT;
-			escape_sequence_char = NO_INPUT;
-		}
-	}
-	hide_cursor();
-	move_cursor(INPUT_NAME_X, INPUT_NAME_Y);
-	clear_to_end_of_line();
-	move_cursor(INPUT_NAME_X, INPUT_NAME_Y-1);
-	clear_to_end_of_line();
-	set_display_attribute(FG_GREEN);
-}
-
-// Processes the serial input for escape characters
-static void process_serial_in(void) {
-	if(serial_input_available()) {
-		// Serial data was available - read the data from standard input
-		serial_input = fgetc(stdin);
-		// Check if the character is part of an escape sequence
-		if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
-			// We've hit the first character in an escape sequence (escape)
-			characters_into_escape_sequence++;
-			serial_input = -1; // Don't further process this character
-		}
-		else if(characters_into_escape_sequence == 1 && serial_input == '[') {
-			// We've hit the second character in an escape sequence
-			characters_into_escape_sequence++;
-			serial_input = -1; // Don't further process this character
-		}
-		else if(characters_into_escape_sequence == 2) {
-			// Third (and last) character in the escape sequence
-			escape_sequence_char = serial_input;			
-			serial_input = -1;  // Don't further process this character - we
-			// deal with it as part of the escape sequence
-			characters_into_escape_sequence = 0;
-		}
-		else {
-			// Character was not part of an escape sequence (or we received
-			// an invalid second character in the sequence). We'll process
-			// the data in the serial_input variable.
-			characters_into_escape_sequence = 0;
-		}
-	}
-}
\ No newline at end of file
+/*
+* highscore.c
+*
+* Author: Michael Bossner
+*/
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "highscore.h"
+#include "terminalio.h"
+#include "audio.h"
+#include "score.h"
+#include "level.h"
+#include "game.h"
+#include "serialio.h"
+#include "idle.h"
+#include "journal.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// X/Y coordinates for the start and end of the highscore area
+#define START_POS_X 23
+#define END_POS_X 57
+#define START_POS_Y 5
+#define END_POS_Y 23
+// X Axis placement of the Columns
+#define RANK START_POS_X + 2
+#define SCORE START_POS_X + 6
+#define LEVEL START_POS_X + 16
+#define NAME START_POS_X + 22
+// Y Axis placement of the Rows. The ranks are double spaced if they fit.
+#define CELL START_POS_Y + 4
+#define FIRST_RANK_ROW (START_POS_Y + 6)
+#define LAST_RANK_ROW (END_POS_Y - 1)
+#define RANK_SPACING ((HIGHSCORE_COUNT - 1) * 2 <= \
+		LAST_RANK_ROW - FIRST_RANK_ROW ? 2 : 1)
+#define RANKS_SHOWN ((LAST_RANK_ROW - FIRST_RANK_ROW) / RANK_SPACING + 1 < \
+		HIGHSCORE_COUNT ? (LAST_RANK_ROW - FIRST_RANK_ROW) / RANK_SPACING \
+		+ 1 : HIGHSCORE_COUNT)
+#define INPUT_NAME_X END_POS_X + 5
+#define INPUT_NAME_Y START_POS_Y + 7
+
+// SpaceBar key ascii value
+#define SPACE 32
+
+// Max characters allowed in a high score name (plus the terminating 0)
+#define NAME_LENGTH 10
+#define MAX_NAME_SIZE (NAME_LENGTH + 1)
+// Names are packed 6 bits a character (see pack_name())
+#define PACKED_NAME_SIZE ((NAME_LENGTH * 6 + 7) / 8)
+// Largest score that can be stored (24 bits)
+#define MAX_SCORE 0xFFFFFFUL
+
+// A highscore. An empty rank is all 0. Each rank is saved as a journal
+// record (see journal.h) which has its own CRC.
+typedef struct {
+	uint8_t name[PACKED_NAME_SIZE];
+	uint8_t score[3];	// least significant byte first
+	uint8_t level;
+} Record;
+
+// Copy of the table in RAM. Ranks are drawn from here.
+static Record ranks[HIGHSCORE_COUNT];
+
+// The name that is input for a highscore winner
+static uint8_t name_input[MAX_NAME_SIZE];
+// Game Over flag
+static uint8_t gameover_flag;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+
+static void terminal_draw_border(void);
+static void draw_ranks(void);
+static void input_highscore(void);
+static uint8_t find_rank(uint32_t score);
+static void insert_highscore(uint8_t rank, uint32_t score, uint8_t level);
+static void save_rank(uint8_t rank);
+static uint32_t record_score(const Record* record);
+static void pack_name(const uint8_t* name, uint8_t* packed);
+static void unpack_name(const uint8_t* packed, char* name);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Loads the highscore table into RAM. A rank that has been lost (e.g. both
+// of its copies in the journal were damaged) is dropped and the ranks below
+// it move up.
+void init_highscore(void) {
+	uint8_t kept = 0;
+	for(uint8_t rank = 0; rank < HIGHSCORE_COUNT; rank++) {
+		journal_read(JOURNAL_KEY_HIGHSCORE + rank, &ranks[kept],
+				sizeof(Record));
+		if(record_score(&ranks[kept]) != 0) {
+			kept++;
+		}
+	}
+	if(kept < HIGHSCORE_COUNT) {
+		memset(&ranks[kept], 0, (HIGHSCORE_COUNT - kept) * sizeof(Record));
+		// Only the ranks that moved up are actually written
+		for(uint8_t rank = 0; rank < HIGHSCORE_COUNT; rank++) {
+			save_rank(rank);
+		}
+	}
+}
+
+// Clears every highscore. The writes are queued and finish in the background.
+void reset_highscores(void) {
+	memset(ranks, 0, sizeof(ranks));
+	for(uint8_t rank = 0; rank < HIGHSCORE_COUNT; rank++) {
+		save_rank(rank);
+	}
+}
+
+// Draws the highscore screen to the terminal. If the game_over flag has been
+// set and a highscore achieved input will be requested by the user for the
+// new highscore.
+void draw_highscore_screen(void) {
+	terminal_draw_border();
+
+	// draws the words that will always be displayed during a highscore screen
+	move_cursor(START_POS_X +13 ,START_POS_Y+2);
+	term_put_string_P(PSTR("Highscore"));
+
+	move_cursor(RANK,CELL);
+	term_put_string_P(PSTR("Rank"));
+	move_cursor(SCORE+3,CELL);
+	term_put_string_P(PSTR("Score"));
+	move_cursor(LEVEL,CELL);
+	term_put_string_P(PSTR("Level"));
+	move_cursor(NAME,CELL);
+	term_put_string_P(PSTR("Name"));
+	draw_ranks();
+
+	// Checks if a highscore has been achieved and adds it to the table
+	if(gameover_flag == TRUE) {
+		gameover_flag = FALSE;
+		uint8_t rank = find_rank(get_score());
+		if(rank < HIGHSCORE_COUNT) {
+			input_highscore();
+			insert_highscore(rank, get_score(), get_level());
+			draw_ranks();
+		}
+	}
+}
+
+// Draws stats to the game over screen and sets the gameover_flag.
+// Also calls draw_highscore_screen()
+void draw_gameover_screen(void) {
+	gameover_flag = TRUE;
+	move_cursor(1,START_POS_Y+4);
+	term_put_string_P(PSTR("Score: "));
+	term_put_unsigned(get_score(), 0);
+	move_cursor(1,START_POS_Y+6);
+	term_put_string_P(PSTR("level: "));
+	term_put_unsigned(get_level(), 0);
+	draw_highscore_screen();
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Draws every rank that fits in the border. Empty ranks are drawn as spaces
+// so a rank that has moved down is drawn over.
+static void draw_ranks(void) {
+	char name[MAX_NAME_SIZE];
+
+	for(uint8_t rank = 0; rank < RANKS_SHOWN; rank++) {
+		uint8_t row = FIRST_RANK_ROW + rank * RANK_SPACING;
+		uint32_t score = record_score(&ranks[rank]);
+
+		set_display_attribute(FG_YELLOW);
+		move_cursor(RANK,row);
+		term_put_unsigned(rank + 1, 3);
+		set_display_attribute(FG_RED);
+		move_cursor(SCORE,row);
+		if(score != 0) {
+			term_put_unsigned(score, 8);
+			term_put_unsigned(ranks[rank].level, 7);
+		} else {
+			term_put_string_P(PSTR("               "));
+		}
+		set_display_attribute(FG_CYAN);
+		move_cursor(NAME,row);
+		unpack_name(ranks[rank].name, name);
+		term_put_string(name);
+		for(uint8_t i = strlen(name); i < NAME_LENGTH; i++) {
+			term_put_string_P(PSTR(" "));
+		}
+	}
+	set_display_attribute(FG_GREEN);
+}
+
+// Returns the rank a score would take or HIGHSCORE_COUNT if it isn't high
+// enough. A score has to beat a rank to take it, so the first to get a score
+// stays above anyone who matches it.
+static uint8_t find_rank(uint32_t score) {
+	if(score > MAX_SCORE) {
+		score = MAX_SCORE;
+	}
+	uint8_t rank = 0;
+	while(rank < HIGHSCORE_COUNT && score <= record_score(&ranks[rank])) {
+		rank++;
+	}
+	return rank;
+}
+
+// Moves the ranks below rank down one (the last drops off) and puts the new
+// highscore with the name that was input in its place. Only the ranks that
+// changed are written back - from rank down to the first that was empty.
+static void insert_highscore(uint8_t rank, uint32_t score, uint8_t level) {
+	uint8_t last = rank;
+	while(last < HIGHSCORE_COUNT - 1 && record_score(&ranks[last]) != 0) {
+		last++;
+	}
+	memmove(&ranks[rank + 1], &ranks[rank], (last - rank) * sizeof(Record));
+
+	Record* record = &ranks[rank];
+	if(score > MAX_SCORE) {
+		score = MAX_SCORE;
+	}
+	pack_name(name_input, record->name);
+	record->score[0] = score;
+	record->score[1] = score >> 8;
+	record->score[2] = score >> 16;
+	record->level = level;
+
+	for(uint8_t i = rank; i <= last; i++) {
+		save_rank(i);
+	}
+}
+
+static void save_rank(uint8_t rank) {
+	journal_write(JOURNAL_KEY_HIGHSCORE + rank, &ranks[rank], sizeof(Record));
+}
+
+static uint32_t record_score(const Record* record) {
+	return record->score[0] | ((uint16_t)record->score[1] << 8) |
+			((uint32_t)record->score[2] << 16);
+}
+
+// Packs a name into 6 bit codes, first character in the lowest bits. 0 ends
+// the name, 1 is a space, 2 to 27 are A to Z and 28 to 53 are a to z.
+static void pack_name(const uint8_t* name, uint8_t* packed) {
+	uint8_t bit = 0;
+
+	memset(packed, 0, PACKED_NAME_SIZE);
+	for(uint8_t i = 0; i < NAME_LENGTH && name[i]; i++) {
+		uint8_t code;
+		if(name[i] >= 'A' && name[i] <= 'Z') {
+			code = name[i] - 'A' + 2;
+		} else if(name[i] >= 'a' && name[i] <= 'z') {
+			code = name[i] - 'a' + 28;
+		} else {
+			code = 1;
+		}
+		for(uint8_t j = 0; j < 6; j++, bit++) {
+			if(code & (1<<j)) {
+				packed[bit / 8] |= 1 << (bit % 8);
+			}
+		}
+	}
+}
+
+// Unpacks a name packed by pack_name() into a 0 terminated string
+static void unpack_name(const uint8_t* packed, char* name) {
+	uint8_t bit = 0;
+	uint8_t i;
+
+	for(i = 0; i < NAME_LENGTH; i++) {
+		uint8_t code = 0;
+		for(uint8_t j = 0; j < 6; j++, bit++) {
+			if(packed[bit / 8] & (1 << (bit % 8))) {
+				code |= 1<<j;
+			}
+		}
+		if(code == 0) {
+			break;
+		} else if(code == 1) {
+			name[i] = ' ';
+		} else if(code < 28) {
+			name[i] = code - 2 + 'A';
+		} else {
+			name[i] = code - 28 + 'a';
+		}
+	}
+	name[i] = '\0';
+}
+
+// Draws the border for the highscore screen
+static void terminal_draw_border(void) {
+	// Top horizontal border line
+	set_display_attribute(FG_MAGENTA);
+	draw_horizontal_line(START_POS_Y, START_POS_X, END_POS_X);
+	// Bottom horizontal border line
+	set_display_attribute(FG_MAGENTA);
+	draw_horizontal_line(END_POS_Y, START_POS_X, END_POS_X);
+	// Left vertical border line
+	set_display_attribute(FG_MAGENTA);
+	draw_vertical_line(START_POS_X, START_POS_Y, END_POS_Y);
+	// Right vertical border line
+	set_display_attribute(FG_MAGENTA);
+	draw_vertical_line(END_POS_X, START_POS_Y, END_POS_Y);
+	set_display_attribute(FG_GREEN);
+}
+
+// Controls the logic for inputing a high score winners name
+static void input_highscore(void) {
+	// clears name_input
+	for(uint8_t i = 0; i<MAX_NAME_SIZE; i++) {
+		name_input[i] = 0;
+	}
+
+	move_cursor(END_POS_X+5, START_POS_Y+4);
+	term_put_string_P(PSTR("NEW HIGH SCORE!!"));
+	move_cursor(END_POS_X+5, START_POS_Y+6);
+	term_put_string_P(PSTR("Enter a name"));
+	move_cursor(INPUT_NAME_X, INPUT_NAME_Y);
+	show_cursor();
+
+	uint8_t i = 0;
+	while(1) {
+		uint8_t key = serial_key_pushed();
+		if(key != KEY_NONE) {
+			set_display_attribute(FG_CYAN);
+
+			if(key == KEY_ENTER) {
+				break;
+			}
+			else if(((key == SPACE) ||
+			(key >= 65 && key <= 90) ||
+			(key >= 97 && key <= 122)) &&
+			(i < 10)) {
+				name_input[i] = key;
+				i++;
+				move_cursor(INPUT_NAME_X, INPUT_NAME_Y);
+				term_put_string((const char*)name_input);
+				move_cursor(INPUT_NAME_X+i, INPUT_NAME_Y);
+				clear_to_end_of_line();
+			}
+			else if((key == KEY_LEFT || key == KEY_BACKSPACE) && (i > 0)) {
+				i--;
+				name_input[i] = 0;
+				move_cursor(INPUT_NAME_X, INPUT_NAME_Y);
+				term_put_string((const char*)name_input);
+				move_cursor(INPUT_NAME_X+i, INPUT_NAME_Y);
+				clear_to_end_of_line();
+			}
+		} else {
+			// Sleep until the next key (or timer tick)
+			idle();
+		}
+	}
+	hide_cursor();
+	move_cursor(END_POS_X+5, START_POS_Y+4);
+	clear_to_end_of_line();
+	move_cursor(INPUT_NAME_X, INPUT_NAME_Y);
+	clear_to_end_of_line();
+	move_cursor(INPUT_NAME_X, INPUT_NAME_Y-1);
+	clear_to_end_of_line();
+	set_display_attribute(FG_GREEN);
+}
@@ -1,36 +1,46 @@
-/*
-* highscore.h
-*
-* Functions for adding a high score system to the game
-*
-*Author: Michael Bossner
-*/
-
-#ifndef HIGHSCORE_H_
-#define HIGHSCORE_H_
-
-#include <stdint.h>
-
-/*
- * Initialises the hardware for use with highscores. If the EEPROM has not
- * been used before for the highscore data space will be allocated and
- * set up for future use.
- */
-void init_highscore(void);
-
-/*
- * Draws the highscore screen and loads highscore data from memory and
- * displays it. If no highscore has been achieved for a position no highscore
- * will be displayed in that spot.
- */
-void draw_highscore_screen(void);
-
-/*
- * Draws game over specific stats to the screen and also calls
- * draw_highscore_screen(). If a highscore has been achieved the screen will
- * request the user to input a name and save that name to the memory as well
- * as display the name on the screen.
- */
-void draw_gameover_screen(void);
-
+/*
+* highscore.h
+*
+* Functions for adding a high score system to the game
+*
+*Author: Michael Bossner
+*/
+
+#ifndef HIGHSCORE_H_
+#define HIGHSCORE_H_
+
+#include <stdint.h>
+
+// Number of ranks kept (e.g. 20 for a top 20). Each takes 12 bytes of RAM
+// and a journal record, and there can be at most JOURNAL_SLOTS - 5 ranks
+// (see journal.h). Only the top ranks that fit are drawn (6 double spaced or
+// 12 single spaced).
+#define HIGHSCORE_COUNT 5
+
+/*
+ * Loads the highscore table from the journal. Ranks that have never been
+ * saved are empty. init_journal() must be called first.
+ */
+void init_highscore(void);
+
+/*
+ * Clears every highscore (names, scores and levels) in EEPROM.
+ */
+void reset_highscores(void);
+
+/*
+ * Draws the highscore screen from the table loaded by init_highscore(). If
+ * no highscore has been achieved for a position no highscore will be
+ * displayed in that spot.
+ */
+void draw_highscore_screen(void);
+
+/*
+ * Draws game over specific stats to the screen and also calls
+ * draw_highscore_screen(). If a highscore has been achieved the screen will
+ * request the user to input a name and save that name to the memory as well
+ * as display the name on the screen. Lower ranks move down to make room.
+ */
+void draw_gameover_screen(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+/*
+ * idle.c
+ *
+ * Author: Michael Bossner
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <string.h>
+
+#include "idle.h"
+#include "timer0.h"
+#include "softtimer.h"
+
+////////////////////////////// Global variables ///////////////////////////////
+
+// Sources that have interrupted since the last sleep started (one bit for
+// each IDLE_WAKE_ value)
+static volatile uint8_t wake_flags;
+static IdleStats stats;
+// Fine time stamp of the last wake up
+static uint16_t last_wake;
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+void init_idle(void) {
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	idle_clear_stats();
+}
+
+// Runs any deferred soft timers, sleeps and then counts the sources that
+// interrupted
+void idle(void) {
+	// Every waiting loop comes through here so the deferred timers (e.g.
+	// the joystick) keep running outside the game too
+	softtimer_run_deferred();
+
+	uint16_t start = get_fine_time();
+	stats.awake += (uint16_t)(start - last_wake);
+	wake_flags = 0;
+
+	sleep_mode();
+
+	uint16_t wake = get_fine_time();
+	stats.asleep += (uint16_t)(wake - start);
+	last_wake = wake;
+	stats.sleeps++;
+
+	uint8_t flags = wake_flags;
+	if(!flags) {
+		flags = (1<<IDLE_WAKE_OTHER);
+	}
+	for(uint8_t source = 0; source < IDLE_NUM_SOURCES; source++) {
+		if(flags & (1<<source)) {
+			stats.wakes[source]++;
+		}
+	}
+}
+
+void idle_delay(uint16_t ms) {
+	uint16_t start = get_ticks16();
+	while(ticks_since(start) < ms) {
+		idle();
+	}
+}
+
+void idle_woken_by(uint8_t source) {
+	wake_flags |= (1<<source);
+}
+
+void idle_get_stats(IdleStats* copy) {
+	*copy = stats;
+}
+
+void idle_clear_stats(void) {
+	memset(&stats, 0, sizeof(stats));
+	last_wake = get_fine_time();
+}
@@ -0,0 +1,68 @@
+/*
+ * idle.h
+ *
+ * Puts the processor into idle sleep while there is nothing to do. Idle
+ * sleep stops the CPU but leaves the timers, serial port and other
+ * peripherals running, so the next interrupt (at most 1ms away - see
+ * timer0.h) wakes it again. The interrupts that woke it are counted so it
+ * can be seen what keeps the processor busy.
+ *
+ * Author: Michael Bossner
+ */
+
+#ifndef IDLE_H_
+#define IDLE_H_
+
+#include <stdint.h>
+
+// Interrupts that wake the processor (see idle_woken_by())
+#define IDLE_WAKE_TIMER		0	// 1ms timer 0 tick
+#define IDLE_WAKE_SERIAL_RX	1	// Byte received
+#define IDLE_WAKE_SERIAL_TX	2	// Room to send the next byte
+#define IDLE_WAKE_EEPROM	3	// Ready for the next byte (see storage.h)
+#define IDLE_WAKE_OTHER		4	// Nothing recorded a wake up
+#define IDLE_NUM_SOURCES	5
+
+typedef struct {
+	uint32_t sleeps;
+	// Wake ups caused by each source. More than one source can be counted
+	// for a wake up if their interrupts came close together.
+	uint32_t wakes[IDLE_NUM_SOURCES];
+	// Time spent asleep and awake in 8us units (see get_fine_time()). A
+	// stretch of more than about half a second without sleeping is counted
+	// short as the fine time wraps.
+	uint32_t asleep;
+	uint32_t awake;
+} IdleStats;
+
+/*
+ * Sets up idle sleep. Must be called before idle() is used.
+ */
+void init_idle(void);
+
+/*
+ * Runs the deferred soft timers (see softtimer_run_deferred()) and then
+ * sleeps until the next interrupt. Called from any loop that is waiting for
+ * something an interrupt handler does.
+ */
+void idle(void);
+
+/*
+ * Sleeps for the given number of ms. The game clock (see get_current_time())
+ * must be running.
+ */
+void idle_delay(uint16_t ms);
+
+/*
+ * Records that an interrupt happened that can wake the processor. Called
+ * from the interrupt handlers with one of the IDLE_WAKE_ values.
+ */
+void idle_woken_by(uint8_t source);
+
+/*
+ * Gets or clears the sleep and wake up figures
+ */
+void idle_get_stats(IdleStats* stats);
+void idle_clear_stats(void);
+
+#endif /* IDLE_H_ */
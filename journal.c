@@ -0,0 +1,234 @@
+/*
+ * journal.c
+ *
+ * Author: Michael Bossner
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <string.h>
+#include <util/crc16.h>
+
+#include "journal.h"
+#include "storage.h"
+
+////////////////////////////// Global variables ///////////////////////////////
+
+// A copy of a record. The CRC-8 covers the other bytes.
+typedef struct {
+	uint16_t sequence;
+	uint8_t key;
+	uint8_t data[JOURNAL_DATA_SIZE];
+	uint8_t crc;
+} Slot;
+
+// The CRC starts from this rather than 0 so that what was in the EEPROM
+// before the journal is unlikely to pass. Erased EEPROM (0xFF) has no key.
+#define CRC_SEED 0x5A
+
+// Marks a record that has no slot (or a slot that holds no record)
+#define NO_SLOT 0xFF
+
+// Free slots needed before a record is written. One is for the record and
+// one is spare for copying records forward (see collect()).
+#define SLOTS_FREE_BEFORE_WRITE 2
+
+static Slot EEMEM slots[JOURNAL_SLOTS];
+
+// Slot holding the newest copy of each record
+static uint8_t newest[JOURNAL_KEYS];
+// The next slot to be written. The free slots are head to tail - 1 and
+// the log is tail to head - 1, going round the ring.
+static uint8_t head;
+static uint8_t tail;
+static uint8_t num_free;
+static uint16_t next_sequence;
+
+// Slots are written from these buffers (see storage_write()). They are
+// used in turn and writes finish in the order they were queued, so the next
+// buffer is free as long as fewer than JOURNAL_BUFFERS writes are waiting.
+#define JOURNAL_BUFFERS 4
+static Slot buffers[JOURNAL_BUFFERS];
+static uint8_t next_buffer;
+static volatile uint8_t writes_waiting;
+
+static JournalStats stats;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+static void collect(void);
+static void append(uint8_t key, const uint8_t* data);
+static void write_done(void);
+static uint8_t slot_key(uint8_t slot);
+static uint8_t slot_valid(const Slot* slot);
+static uint8_t slot_crc(const Slot* slot);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Goes through the slots once keeping the newest good copy of each record.
+// Sequence numbers wrap so they are compared by their difference. Writing
+// carries on after the newest slot, skipping any that still hold a record.
+void init_journal(void) {
+	uint16_t sequences[JOURNAL_KEYS];
+	uint8_t last = NO_SLOT;
+	Slot slot;
+
+	memset(newest, NO_SLOT, sizeof(newest));
+	for(uint8_t i = 0; i < JOURNAL_SLOTS; i++) {
+		storage_read(&slot, &slots[i], sizeof(slot));
+		if(!slot_valid(&slot)) {
+			continue;
+		}
+		uint8_t key = slot.key;
+		if(newest[key] == NO_SLOT ||
+				(int16_t)(slot.sequence - sequences[key]) > 0) {
+			newest[key] = i;
+			sequences[key] = slot.sequence;
+		}
+		if(last == NO_SLOT || (int16_t)(slot.sequence - next_sequence) >= 0) {
+			last = i;
+			next_sequence = slot.sequence + 1;
+		}
+	}
+
+	head = last == NO_SLOT ? 0 : (last + 1) % JOURNAL_SLOTS;
+	while(slot_key(head) != NO_SLOT) {
+		head = (head + 1) % JOURNAL_SLOTS;
+	}
+	num_free = 0;
+	tail = head;
+	while(num_free < JOURNAL_SLOTS && slot_key(tail) == NO_SLOT) {
+		num_free++;
+		tail = (tail + 1) % JOURNAL_SLOTS;
+	}
+}
+
+uint8_t journal_read(uint8_t key, void* data, uint8_t length) {
+	if(newest[key] == NO_SLOT) {
+		memset(data, 0, length);
+		return 0;
+	}
+	storage_read(data, slots[newest[key]].data, length);
+	return 1;
+}
+
+void journal_write(uint8_t key, const void* data, uint8_t length) {
+	uint8_t record[JOURNAL_DATA_SIZE];
+	uint8_t saved[JOURNAL_DATA_SIZE];
+
+	memset(record, 0, sizeof(record));
+	memcpy(record, data, length);
+	journal_read(key, saved, sizeof(saved));
+	if(memcmp(record, saved, sizeof(record)) == 0) {
+		stats.skipped++;
+		return;
+	}
+	collect();
+	append(key, record);
+	stats.writes++;
+}
+
+uint8_t journal_check(void) {
+	Slot slot;
+
+	for(uint8_t key = 0; key < JOURNAL_KEYS; key++) {
+		if(newest[key] == NO_SLOT) {
+			continue;
+		}
+		storage_read(&slot, &slots[newest[key]], sizeof(slot));
+		if(!slot_valid(&slot) || slot.key != key) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void journal_get_stats(JournalStats* copy) {
+	*copy = stats;
+	copy->live = 0;
+	for(uint8_t key = 0; key < JOURNAL_KEYS; key++) {
+		if(newest[key] != NO_SLOT) {
+			copy->live++;
+		}
+	}
+	copy->free = num_free;
+	copy->sequence = next_sequence;
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Frees slots at the tail of the log until there is room for a write with
+// a slot to spare. Old copies are just dropped. The newest copy of a record
+// is copied to the head first, which uses the spare slot but frees the one
+// it came from. There are always more slots than records so this finishes.
+static void collect(void) {
+	uint8_t data[JOURNAL_DATA_SIZE];
+
+	while(num_free < SLOTS_FREE_BEFORE_WRITE) {
+		uint8_t key = slot_key(tail);
+		if(key != NO_SLOT) {
+			storage_read(data, slots[tail].data, sizeof(data));
+			append(key, data);
+			stats.copies++;
+		}
+		tail = (tail + 1) % JOURNAL_SLOTS;
+		num_free++;
+	}
+}
+
+// Writes a record to the head slot. It becomes the newest copy straight
+// away as storage_read() includes writes that haven't finished.
+static void append(uint8_t key, const uint8_t* data) {
+	while(writes_waiting == JOURNAL_BUFFERS) {
+		storage_flush();
+	}
+	Slot* slot = &buffers[next_buffer];
+	next_buffer = (next_buffer + 1) % JOURNAL_BUFFERS;
+
+	slot->sequence = next_sequence++;
+	slot->key = key;
+	memcpy(slot->data, data, JOURNAL_DATA_SIZE);
+	slot->crc = slot_crc(slot);
+
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	writes_waiting++;
+	if(interrupts_were_enabled) {
+		sei();
+	}
+	storage_write(&slots[head], slot, sizeof(Slot), write_done);
+
+	newest[key] = head;
+	head = (head + 1) % JOURNAL_SLOTS;
+	num_free--;
+}
+
+// Called from the EEPROM interrupt handler when a slot has been written
+static void write_done(void) {
+	writes_waiting--;
+}
+
+// Returns the record the slot holds the newest copy of, or NO_SLOT if it
+// can be written over
+static uint8_t slot_key(uint8_t slot) {
+	for(uint8_t key = 0; key < JOURNAL_KEYS; key++) {
+		if(newest[key] == slot) {
+			return key;
+		}
+	}
+	return NO_SLOT;
+}
+
+static uint8_t slot_valid(const Slot* slot) {
+	return slot->key < JOURNAL_KEYS && slot_crc(slot) == slot->crc;
+}
+
+// CRC-8 of every byte but the CRC
+static uint8_t slot_crc(const Slot* slot) {
+	const uint8_t* bytes = (const uint8_t*)slot;
+	uint8_t crc = CRC_SEED;
+	for(uint8_t i = 0; i < sizeof(Slot) - 1; i++) {
+		crc = _crc8_ccitt_update(crc, bytes[i]);
+	}
+	return crc;
+}
@@ -0,0 +1,90 @@
+/*
+ * journal.h
+ *
+ * Keeps the high scores and settings in a log in EEPROM so that saving them
+ * doesn't wear out the same cells every time. Each EEPROM cell only lasts
+ * about 100,000 writes. The log is a ring of 16 byte slots. Every save
+ * writes a new copy of the record to the next slot with a sequence number
+ * and a CRC. The old copy is left where it is until the log comes round to
+ * it again. Records that haven't changed in a while are copied forward
+ * before their slot is reused, so every slot gets written about as often.
+ * At start up the slots are read once and the newest good copy of each
+ * record is kept. A copy that was only half written when the power went off
+ * fails its CRC, so the copy before it is used instead.
+ *
+ * Author: Michael Bossner
+ */
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <stdint.h>
+
+#include "highscore.h"
+#include "keymap.h"
+
+// Number of slots in the log. Each takes 16 bytes of EEPROM.
+#define JOURNAL_SLOTS 32
+// Most data a record can hold
+#define JOURNAL_DATA_SIZE 12
+
+// Records (keys) kept in the journal
+#define JOURNAL_KEY_BAUDRATE	0
+// Player key bindings. They take more than one record.
+#define JOURNAL_KEY_KEYMAP		1
+#define JOURNAL_KEYMAP_RECORDS	((KEYMAP_OVERRIDES * 2 + \
+		JOURNAL_DATA_SIZE - 1) / JOURNAL_DATA_SIZE)
+// One record per rank
+#define JOURNAL_KEY_HIGHSCORE	(JOURNAL_KEY_KEYMAP + JOURNAL_KEYMAP_RECORDS)
+#define JOURNAL_KEYS			(JOURNAL_KEY_HIGHSCORE + HIGHSCORE_COUNT)
+
+// Every record needs a slot and two more must be free for the log to move
+// on. The rest of the slots spread the writes out, so the more records
+// there are (e.g. a larger HIGHSCORE_COUNT) the more often each slot is
+// written.
+#if JOURNAL_KEYS > JOURNAL_SLOTS - 2
+#error "Too many journal records for the number of slots"
+#endif
+
+typedef struct {
+	uint8_t live;		// Slots holding the newest copy of a record
+	uint8_t free;		// Slots that can be written without copying first
+	uint16_t sequence;	// Sequence number of the next write
+	uint16_t writes;	// Records saved since start up
+	uint16_t copies;	// Records copied forward since start up
+	uint16_t skipped;	// Saves skipped since the record hadn't changed
+} JournalStats;
+
+/*
+ * Reads the log and finds the newest copy of each record. Must be called
+ * before any of the other journal functions.
+ */
+void init_journal(void);
+
+/*
+ * Reads length bytes of a record into data. Returns non-zero if the record
+ * has been saved before. If it hasn't, data is filled with zeros and 0 is
+ * returned.
+ */
+uint8_t journal_read(uint8_t key, void* data, uint8_t length);
+
+/*
+ * Saves length bytes (at most JOURNAL_DATA_SIZE) of a record. The rest of
+ * the record is zero. Nothing is written if the record already holds the
+ * data. The write is finished in the background (see storage.h) and data
+ * can be reused as soon as this returns.
+ */
+void journal_write(uint8_t key, const void* data, uint8_t length);
+
+/*
+ * Re-reads the newest copy of every record and checks its CRC. Returns
+ * non-zero if they are all good.
+ */
+uint8_t journal_check(void);
+
+/*
+ * Gets the figures shown by the console
+ */
+void journal_get_stats(JournalStats* stats);
+
+#endif /* JOURNAL_H_ */
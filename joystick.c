@@ -1,147 +1,209 @@
-/*
-* joystick.c
-*
-*Author: Michael Bossner
-*/
-
-#include <stdio.h>
-#include <avr/io.h>
-
-#include "joystick.h"
-#include "timer0.h"
-
-////////////////////////////// Global variables ////////////////////////////////
-
-// time before a move can repeat
-#define REPEAT_MOVE 250
-// Multiplier sensitivity for the joystick from rest position
-// (REST_VALUE*MOVE_JOYSTICK) * or / as rest is in the middle.
-#define MOVE_JOYSTICK 1.3
-#define MOVE_JOYSTICK_DIAGONAL 1.1
-// max movements allowed to be queued
-#define MAX_QUEUE_SIZE 8
-
-// these values should not be changed after init_joystick is called.
-static uint16_t JOYSTICK_X_REST;
-static uint16_t JOYSTICK_Y_REST;
-// The time a joystick move was last queued
-static uint32_t joystick_last_moved;
-// Queue of joystick moves
-static volatile uint8_t joystick_queue[MAX_QUEUE_SIZE];
-static volatile uint8_t queue_length;
-
-/////////////////// Function Prototypes for Helper Functions ///////////////////
-
-static uint16_t get_joystick_x(void);
-static uint16_t get_joystick_y(void);
-static void joystick_move_helper(uint8_t move);
-
-/////////////////////////////// Public Functions ///////////////////////////////
-
-// Initialises the joystick hardware for use in the game
-void init_joystick(void) {
-	// Set up ADC - AVCC reference, right adjust
-	ADMUX = (1<<REFS0);
-
-	// Turn on the ADC (but don't start a conversion yet). Choose a clock
-	// divider of 64. (The ADC clock must be somewhere
-	// between 50kHz and 200kHz. We will divide our 8MHz clock by 64
-	// to give us 125kHz.)
-	ADCSRA = (1<<ADEN)|(1<<ADPS2)|(1<<ADPS1);
-
-	JOYSTICK_X_REST = get_joystick_x();
-	JOYSTICK_Y_REST = get_joystick_y();
-
-	clear_joystick_queue();
-
-	joystick_last_moved = get_current_time();
-}
-
-// If the joystick has been moved past a certain point and the rest time has
-// past a move will be queued and the rest time will be reset.
-void joystick_move(void) {
-	if((get_current_time() >= (joystick_last_moved + REPEAT_MOVE)) &&
-	(queue_length <= MAX_QUEUE_SIZE)) {
-
-		if((get_joystick_y() >= JOYSTICK_Y_REST*MOVE_JOYSTICK_DIAGONAL) &&
-		(get_joystick_x() >= JOYSTICK_X_REST*MOVE_JOYSTICK_DIAGONAL)){
-				joystick_move_helper(MOVE_UP_LEFT);
-			}
-		else if((get_joystick_y() >= JOYSTICK_Y_REST*MOVE_JOYSTICK_DIAGONAL) &&
-		(get_joystick_x() <= JOYSTICK_X_REST/MOVE_JOYSTICK_DIAGONAL)) {
-			joystick_move_helper(MOVE_UP_RIGHT);
-		}
-		else if((get_joystick_y() <= JOYSTICK_Y_REST/MOVE_JOYSTICK_DIAGONAL) &&
-		(get_joystick_x() >= JOYSTICK_X_REST*MOVE_JOYSTICK_DIAGONAL)) {
-			joystick_move_helper(MOVE_DOWN_LEFT);
-		}
-		else if((get_joystick_y() <= JOYSTICK_Y_REST/MOVE_JOYSTICK_DIAGONAL) &&
-		(get_joystick_x() <= JOYSTICK_X_REST/MOVE_JOYSTICK_DIAGONAL)) {
-			joystick_move_helper(MOVE_DOWN_RIGHT);
-		}
-		else if(get_joystick_y() >= JOYSTICK_Y_REST*MOVE_JOYSTICK) {
-			joystick_move_helper(MOVE_UP);
-		}
-		else if(get_joystick_x() >= JOYSTICK_X_REST*MOVE_JOYSTICK) {
-			joystick_move_helper(MOVE_LEFT);
-		}
-		else if(get_joystick_x() <= JOYSTICK_X_REST/MOVE_JOYSTICK) {
-			joystick_move_helper(MOVE_RIGHT);
-		}
-		else if(get_joystick_y() <= JOYSTICK_Y_REST/MOVE_JOYSTICK) {
-			joystick_move_helper(MOVE_DOWN);
-		}
-	}
-}
-
-// Pulls a joystick move out of the queue and returns the value.
-// If no move is in the queue return 0
-uint8_t get_joystick_move(void) {
-	uint8_t retur_value;
-	if(queue_length > 0) {
-		retur_value = joystick_queue[0];
-		queue_length--;
-		return retur_value;
-	} else {
-		return 0;
-	}
-}
-
-// Clears the entire joystick queue
-void clear_joystick_queue(void) {
-	for(uint8_t i = 0; i < MAX_QUEUE_SIZE; i++) {
-		joystick_queue[i] = 0;
-		queue_length = 0;
-	}
-}
-
-/////////////////////////////// Private (Helper) Functions /////////////////////
-
-// Simple helper function
-static void joystick_move_helper(uint8_t move) {
-	joystick_queue[queue_length] = move;
-	queue_length++;
-	joystick_last_moved = get_current_time();
-}
-
-// Converts an input on the ADC and returns the value of the X axis
-static uint16_t get_joystick_x(void) {
-	ADMUX &= ~1;
-	ADCSRA |= (1<<ADSC);
-	while(ADCSRA & (1<<ADSC)) {
-		; /* Wait until conversion finished */
-	}
-	uint16_t value = ADC; // read the value
-	return value;
-}
-
-// Converts an input on the ADC and returns the value of the Y axis
-static uint16_t get_joystick_y(void) {
-	ADMUX |= 1;
-	ADCSRA |= (1<<ADSC);
-	while(ADCSRA & (1<<ADSC)) {
-		; /* Wait until conversion finished */
-	}
-	uint16_t value = ADC; // read the value
-	return value;
-}
+/*
+* joystick.c
+*
+*Author: Michael Bossner
+*/
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "joystick.h"
+#include "timer0.h"
+#include "repeat.h"
+#include "softtimer.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Multiplier sensitivity for the joystick from rest position
+// (REST_VALUE*MOVE_JOYSTICK) * or / as rest is in the middle.
+#define MOVE_JOYSTICK 1.3
+#define MOVE_JOYSTICK_DIAGONAL 1.1
+// max movements allowed to be queued
+#define MAX_QUEUE_SIZE 8
+// Time (ms) between joystick samples
+#define JOYSTICK_SAMPLE_PERIOD 10
+
+// these values should not be changed after init_joystick is called.
+static uint16_t JOYSTICK_X_REST;
+static uint16_t JOYSTICK_Y_REST;
+// The direction the joystick is currently held in (0 if at rest)
+static uint8_t held_move;
+// Auto-repeat state for the held direction
+static RepeatState joystick_repeat;
+// Queue of joystick moves
+static volatile uint8_t joystick_queue[MAX_QUEUE_SIZE];
+// Fine time stamp (see get_fine_time32()) of each move in the queue
+static volatile uint32_t joystick_stamps[MAX_QUEUE_SIZE];
+static volatile uint8_t queue_length;
+// Soft timer that samples the joystick, or -1 if none was free. Without one
+// the joystick is sampled from get_joystick_move() instead.
+static int8_t sample_timer = -1;
+// When get_joystick_move() last sampled the joystick (see get_ticks16())
+static uint16_t last_sample;
+// Stamp of the move last returned by get_joystick_move()
+static uint32_t last_stamp;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+
+static uint16_t get_joystick_x(void);
+static uint16_t get_joystick_y(void);
+static uint8_t joystick_direction(void);
+static void joystick_move_helper(uint8_t move);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Initialises the joystick hardware for use in the game
+void init_joystick(void) {
+	// Set up ADC - AVCC reference, right adjust
+	ADMUX = (1<<REFS0);
+
+	// Turn on the ADC (but don't start a conversion yet). Choose a clock
+	// divider of 64. (The ADC clock must be somewhere
+	// between 50kHz and 200kHz. We will divide our 8MHz clock by 64
+	// to give us 125kHz.)
+	ADCSRA = (1<<ADEN)|(1<<ADPS2)|(1<<ADPS1);
+
+	JOYSTICK_X_REST = get_joystick_x();
+	JOYSTICK_Y_REST = get_joystick_y();
+
+	clear_joystick_queue();
+
+	held_move = 0;
+	repeat_reset(&joystick_repeat);
+
+	// Each sample waits for two ADC conversions so it is deferred to the
+	// main loop rather than holding up the timer interrupt
+	sample_timer = softtimer_add(joystick_move, JOYSTICK_SAMPLE_PERIOD,
+			SOFTTIMER_PRIORITY_LOW, SOFTTIMER_DEFERRED, PSTR("joystick"));
+	last_sample = get_ticks16();
+}
+
+// Queues a move when the joystick is first pushed past a certain point. If it
+// is held there the move is queued again by the shared repeat engine.
+void joystick_move(void) {
+	uint32_t now = get_loop_time();
+	uint8_t move = joystick_direction();
+
+	if(move != held_move) {
+		held_move = move;
+		if(move) {
+			joystick_move_helper(move);
+			repeat_start(&joystick_repeat, move, now);
+		} else {
+			repeat_reset(&joystick_repeat);
+		}
+	} else if(move && repeat_due(&joystick_repeat, move, now) != NO_KEY_HELD) {
+		joystick_move_helper(move);
+	}
+}
+
+// Pulls a joystick move out of the queue and returns the value.
+// If no move is in the queue return 0
+uint8_t get_joystick_move(void) {
+	uint8_t retur_value = 0;
+	if(sample_timer < 0 &&
+			ticks_since(last_sample) >= JOYSTICK_SAMPLE_PERIOD) {
+		last_sample = get_ticks16();
+		joystick_move();
+	}
+	if(queue_length > 0) {
+		// Interrupts are turned off while we move everything along
+		uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+		cli();
+		retur_value = joystick_queue[0];
+		last_stamp = joystick_stamps[0];
+		for(uint8_t i = 1; i < queue_length; i++) {
+			joystick_queue[i-1] = joystick_queue[i];
+			joystick_stamps[i-1] = joystick_stamps[i];
+		}
+		queue_length--;
+		if(interrupts_were_enabled) {
+			sei();
+		}
+	}
+	return retur_value;
+}
+
+// Returns the time stamp of the last move returned
+uint32_t get_joystick_stamp(void) {
+	return last_stamp;
+}
+
+// Clears the entire joystick queue
+void clear_joystick_queue(void) {
+	for(uint8_t i = 0; i < MAX_QUEUE_SIZE; i++) {
+		joystick_queue[i] = 0;
+		queue_length = 0;
+	}
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Returns the direction the joystick is pushed in or 0 if it is at rest.
+// Each axis is only converted once.
+static uint8_t joystick_direction(void) {
+	uint16_t x = get_joystick_x();
+	uint16_t y = get_joystick_y();
+
+	if((y >= JOYSTICK_Y_REST*MOVE_JOYSTICK_DIAGONAL) &&
+	(x >= JOYSTICK_X_REST*MOVE_JOYSTICK_DIAGONAL)) {
+		return MOVE_UP_LEFT;
+	}
+	else if((y >= JOYSTICK_Y_REST*MOVE_JOYSTICK_DIAGONAL) &&
+	(x <= JOYSTICK_X_REST/MOVE_JOYSTICK_DIAGONAL)) {
+		return MOVE_UP_RIGHT;
+	}
+	else if((y <= JOYSTICK_Y_REST/MOVE_JOYSTICK_DIAGONAL) &&
+	(x >= JOYSTICK_X_REST*MOVE_JOYSTICK_DIAGONAL)) {
+		return MOVE_DOWN_LEFT;
+	}
+	else if((y <= JOYSTICK_Y_REST/MOVE_JOYSTICK_DIAGONAL) &&
+	(x <= JOYSTICK_X_REST/MOVE_JOYSTICK_DIAGONAL)) {
+		return MOVE_DOWN_RIGHT;
+	}
+	else if(y >= JOYSTICK_Y_REST*MOVE_JOYSTICK) {
+		return MOVE_UP;
+	}
+	else if(x >= JOYSTICK_X_REST*MOVE_JOYSTICK) {
+		return MOVE_LEFT;
+	}
+	else if(x <= JOYSTICK_X_REST/MOVE_JOYSTICK) {
+		return MOVE_RIGHT;
+	}
+	else if(y <= JOYSTICK_Y_REST/MOVE_JOYSTICK) {
+		return MOVE_DOWN;
+	}
+	return 0;
+}
+
+// Adds a move to the queue if there is space
+static void joystick_move_helper(uint8_t move) {
+	if(queue_length < MAX_QUEUE_SIZE) {
+		joystick_stamps[queue_length] = get_fine_time32();
+		joystick_queue[queue_length] = move;
+		queue_length++;
+	}
+}
+
+// Converts an input on the ADC and returns the value of the X axis
+static uint16_t get_joystick_x(void) {
+	ADMUX &= ~1;
+	ADCSRA |= (1<<ADSC);
+	while(ADCSRA & (1<<ADSC)) {
+		; /* Wait until conversion finished */
+	}
+	uint16_t value = ADC; // read the value
+	return value;
+}
+
+// Converts an input on the ADC and returns the value of the Y axis
+static uint16_t get_joystick_y(void) {
+	ADMUX |= 1;
+	ADCSRA |= (1<<ADSC);
+	while(ADCSRA & (1<<ADSC)) {
+		; /* Wait until conversion finished */
+	}
+	uint16_t value = ADC; // read the value
+	return value;
+}
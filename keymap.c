@@ -0,0 +1,213 @@
+/*
+* keymap.c
+*
+* Author: Michael Bossner
+*/
+
+#include <avr/pgmspace.h>
+
+#include "keymap.h"
+#include "serialio.h"
+#include "terminalio.h"
+#include "joystick.h"
+#include "game.h"
+#include "journal.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Terminal row used by the rebind prompt
+#define PROMPT_ROW 3
+
+// Each binding is a keycode followed by its action. A keycode of KEY_NONE
+// marks a free slot. They are saved in JOURNAL_KEYMAP_RECORDS journal
+// records, so bindings that have never been saved are all free.
+static uint8_t bindings[KEYMAP_OVERRIDES][2];
+
+// Default action for every keycode
+static const uint8_t default_keymap[256] PROGMEM = {
+	['a'] = ACTION_LEFT,
+	['A'] = ACTION_LEFT,
+	[KEY_LEFT] = ACTION_LEFT,
+	[KEY_BUTTON(3)] = ACTION_LEFT,
+	[KEY_JOYSTICK(MOVE_LEFT)] = ACTION_LEFT,
+	['w'] = ACTION_FORWARD,
+	['W'] = ACTION_FORWARD,
+	[KEY_UP] = ACTION_FORWARD,
+	[KEY_BUTTON(2)] = ACTION_FORWARD,
+	[KEY_JOYSTICK(MOVE_UP)] = ACTION_FORWARD,
+	['s'] = ACTION_BACKWARD,
+	['S'] = ACTION_BACKWARD,
+	[KEY_DOWN] = ACTION_BACKWARD,
+	[KEY_BUTTON(1)] = ACTION_BACKWARD,
+	[KEY_JOYSTICK(MOVE_DOWN)] = ACTION_BACKWARD,
+	['d'] = ACTION_RIGHT,
+	['D'] = ACTION_RIGHT,
+	[KEY_RIGHT] = ACTION_RIGHT,
+	[KEY_BUTTON(0)] = ACTION_RIGHT,
+	[KEY_JOYSTICK(MOVE_RIGHT)] = ACTION_RIGHT,
+	[KEY_JOYSTICK(MOVE_UP_LEFT)] = ACTION_UP_LEFT,
+	[KEY_JOYSTICK(MOVE_UP_RIGHT)] = ACTION_UP_RIGHT,
+	[KEY_JOYSTICK(MOVE_DOWN_LEFT)] = ACTION_DOWN_LEFT,
+	[KEY_JOYSTICK(MOVE_DOWN_RIGHT)] = ACTION_DOWN_RIGHT,
+	['p'] = ACTION_PAUSE,
+	['P'] = ACTION_PAUSE,
+	[KEY_F1] = ACTION_LATENCY_REPORT,
+	[KEY_F3] = ACTION_SERIAL_REPORT,
+	[KEY_F4] = ACTION_BAUD_RATE,
+	[KEY_F5] = ACTION_MIRROR,
+	[KEY_F6] = ACTION_TELEMETRY,
+	[KEY_F7] = ACTION_SERVICE,
+	[KEYMAP_BIND_KEY] = ACTION_BIND
+};
+
+// Rebind prompt state
+#define REBIND_IDLE 0
+#define REBIND_WANT_KEY 1
+#define REBIND_WANT_ACTION 2
+static uint8_t rebind_state;
+static uint8_t rebind_key;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+
+static void save_bindings(void);
+static uint8_t record_length(uint8_t record);
+static void clear_prompt(void);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Loads the player bindings
+void init_keymap(void) {
+	for(uint8_t i = 0; i < JOURNAL_KEYMAP_RECORDS; i++) {
+		journal_read(JOURNAL_KEY_KEYMAP + i,
+				&bindings[0][0] + i * JOURNAL_DATA_SIZE, record_length(i));
+	}
+	rebind_state = REBIND_IDLE;
+}
+
+// Returns the action for the keycode. Player bindings are checked first.
+uint8_t keymap_action(uint8_t key) {
+	if(key == KEY_NONE) {
+		return ACTION_NONE;
+	}
+	for(uint8_t i = 0; i < KEYMAP_OVERRIDES; i++) {
+		if(bindings[i][0] == key) {
+			return bindings[i][1];
+		}
+	}
+	return pgm_read_byte(&default_keymap[key]);
+}
+
+// Binds a key to an action
+uint8_t keymap_bind(uint8_t key, uint8_t action) {
+	if(key == KEY_NONE || key == KEYMAP_BIND_KEY || action >= NUM_ACTIONS) {
+		return FALSE;
+	}
+	// Find the key's existing slot and a free one
+	uint8_t slot = KEYMAP_OVERRIDES;
+	uint8_t free_slot = KEYMAP_OVERRIDES;
+	for(uint8_t i = 0; i < KEYMAP_OVERRIDES; i++) {
+		if(bindings[i][0] == key) {
+			slot = i;
+		} else if(bindings[i][0] == KEY_NONE && free_slot == KEYMAP_OVERRIDES) {
+			free_slot = i;
+		}
+	}
+	if(action == pgm_read_byte(&default_keymap[key])) {
+		// Back to the default - free the slot if it has one
+		if(slot != KEYMAP_OVERRIDES) {
+			bindings[slot][0] = KEY_NONE;
+			bindings[slot][1] = ACTION_NONE;
+			save_bindings();
+		}
+		return TRUE;
+	}
+	if(slot == KEYMAP_OVERRIDES) {
+		slot = free_slot;
+	}
+	if(slot == KEYMAP_OVERRIDES) {
+		return FALSE;
+	}
+	bindings[slot][0] = key;
+	bindings[slot][1] = action;
+	save_bindings();
+	return TRUE;
+}
+
+// Removes every player binding
+void keymap_reset(void) {
+	for(uint8_t i = 0; i < KEYMAP_OVERRIDES; i++) {
+		bindings[i][0] = KEY_NONE;
+		bindings[i][1] = ACTION_NONE;
+	}
+	save_bindings();
+}
+
+// Starts the rebind prompt
+void keymap_start_rebind(void) {
+	rebind_state = REBIND_WANT_KEY;
+	move_cursor(1, PROMPT_ROW);
+	clear_to_end_of_line();
+	term_put_string_P(PSTR("Rebind: press the key to change"));
+}
+
+uint8_t keymap_rebinding(void) {
+	return rebind_state != REBIND_IDLE;
+}
+
+// Steps the rebind prompt along with the given key
+void keymap_rebind_key(uint8_t key) {
+	if(key == KEY_NONE) {
+		return;
+	}
+	if(rebind_state == REBIND_WANT_KEY) {
+		if(key == KEYMAP_BIND_KEY) {
+			clear_prompt();
+			return;
+		}
+		rebind_key = key;
+		rebind_state = REBIND_WANT_ACTION;
+		move_cursor(1, PROMPT_ROW);
+		clear_to_end_of_line();
+		term_put_string_P(PSTR("Key "));
+		term_put_unsigned(rebind_key, 0);
+		term_put_string_P(PSTR(": 0 none 1 left 2 up 3 down 4 right 5 up-left "
+				"6 up-right 7 down-left 8 down-right 9 pause a latency"));
+	} else if(rebind_state == REBIND_WANT_ACTION) {
+		uint8_t action = NUM_ACTIONS;
+		if(key >= '0' && key <= '9') {
+			action = key - '0';
+		} else if(key == 'a') {
+			action = ACTION_LATENCY_REPORT;
+		}
+		// Any other key cancels
+		if(action < ACTION_BIND) {
+			keymap_bind(rebind_key, action);
+		}
+		clear_prompt();
+	}
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Saves the bindings to the journal. Only the records that changed are
+// written.
+static void save_bindings(void) {
+	for(uint8_t i = 0; i < JOURNAL_KEYMAP_RECORDS; i++) {
+		journal_write(JOURNAL_KEY_KEYMAP + i,
+				&bindings[0][0] + i * JOURNAL_DATA_SIZE, record_length(i));
+	}
+}
+
+// Returns the number of bytes of the bindings in a journal record. The last
+// record may not be full.
+static uint8_t record_length(uint8_t record) {
+	uint8_t left = sizeof(bindings) - record * JOURNAL_DATA_SIZE;
+	return left < JOURNAL_DATA_SIZE ? left : JOURNAL_DATA_SIZE;
+}
+
+// Removes the rebind prompt from the terminal
+static void clear_prompt(void) {
+	rebind_state = REBIND_IDLE;
+	move_cursor(1, PROMPT_ROW);
+	clear_to_end_of_line();
+}
@@ -0,0 +1,88 @@
+/*
+* keymap.h
+*
+* Maps every input (serial keys, buttons and joystick moves) to a game action
+* through a single keycode lookup. Default bindings live in a 256 entry
+* PROGMEM table and a few player bindings are kept in EEPROM.
+*
+*Author: Michael Bossner
+*/
+
+#ifndef KEYMAP_H_
+#define KEYMAP_H_
+
+#include <stdint.h>
+
+// Keycodes for the buttons and joystick. They sit above the serial keys
+// (see KEY_ in serialio.h) so that every input has its own keycode.
+#define KEY_BUTTON(n) (0xA0 + (n))
+#define KEY_JOYSTICK(move) (0xB0 + (move))
+
+// The key that opens the rebind prompt. It can't be rebound.
+#define KEYMAP_BIND_KEY KEY_F2
+
+// Maximum number of player bindings stored in EEPROM
+#define KEYMAP_OVERRIDES 8
+
+// Game actions. The order matches the action handler table in project.c.
+typedef enum {
+	ACTION_NONE,
+	ACTION_LEFT,
+	ACTION_FORWARD,
+	ACTION_BACKWARD,
+	ACTION_RIGHT,
+	ACTION_UP_LEFT,
+	ACTION_UP_RIGHT,
+	ACTION_DOWN_LEFT,
+	ACTION_DOWN_RIGHT,
+	ACTION_PAUSE,
+	ACTION_LATENCY_REPORT,
+	ACTION_BIND,
+	ACTION_SERIAL_REPORT,
+	ACTION_BAUD_RATE,
+	ACTION_MIRROR,
+	ACTION_TELEMETRY,
+	ACTION_SERVICE,
+	NUM_ACTIONS
+} Action;
+
+/*
+ * Loads the player bindings from EEPROM. If they have never been saved the
+ * defaults are used.
+ */
+void init_keymap(void);
+
+/*
+ * Returns the action bound to the given keycode.
+ */
+uint8_t keymap_action(uint8_t key);
+
+/*
+ * Binds a key to an action and saves it to EEPROM. Binding a key back to its
+ * default action frees its slot. Returns 0 if the key can't be rebound or
+ * there is no free slot, non-zero otherwise.
+ */
+uint8_t keymap_bind(uint8_t key, uint8_t action);
+
+/*
+ * Removes every player binding.
+ */
+void keymap_reset(void);
+
+/*
+ * Starts the rebind prompt on the terminal. The next key pressed is the key
+ * to rebind and the one after is the action (typed on the serial console).
+ */
+void keymap_start_rebind(void);
+
+/*
+ * Returns non-zero while the rebind prompt is waiting for a key.
+ */
+uint8_t keymap_rebinding(void);
+
+/*
+ * Passes a key to the rebind prompt.
+ */
+void keymap_rebind_key(uint8_t key);
+
+#endif
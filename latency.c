@@ -0,0 +1,149 @@
+/*
+* latency.c
+*
+* Author: Michael Bossner
+*/
+
+#include <avr/pgmspace.h>
+
+#include "latency.h"
+#include "timer0.h"
+#include "terminalio.h"
+#include "game.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Microseconds per fine time unit
+#define US_PER_TICK 8
+
+static uint16_t histogram[LATENCY_BUCKETS];
+static uint16_t samples;
+static uint32_t min_latency;
+static uint32_t max_latency;
+static uint32_t total_latency;
+
+// Stamp of the input waiting for the frog to be drawn
+static uint32_t pending_stamp;
+static uint8_t pending;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+static uint16_t clamp(uint32_t latency);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Empties the histogram
+void latency_reset(void) {
+	for(uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+		histogram[i] = 0;
+	}
+	samples = 0;
+	min_latency = UINT32_MAX;
+	max_latency = 0;
+	total_latency = 0;
+	pending = FALSE;
+}
+
+// Remembers the stamp of the input being acted on
+void latency_input(uint32_t stamp) {
+	pending_stamp = stamp;
+	pending = TRUE;
+}
+
+// Adds the waiting input (if any) to the histogram
+void latency_frog_drawn(void) {
+	if(!pending) {
+		return;
+	}
+	pending = FALSE;
+
+	// 32 bit stamps so an input that waited through a level change is
+	// measured rather than wrapping round to a short time
+	uint32_t latency = get_fine_time32() - pending_stamp;
+	uint32_t bucket = latency >> LATENCY_BUCKET_SHIFT;
+	if(bucket >= LATENCY_BUCKETS) {
+		bucket = LATENCY_BUCKETS - 1;
+	}
+	// Stop counting rather than wrap around
+	if(samples == UINT16_MAX || total_latency > UINT32_MAX - latency) {
+		return;
+	}
+	histogram[bucket]++;
+	samples++;
+	total_latency += latency;
+	if(latency < min_latency) {
+		min_latency = latency;
+	}
+	if(latency > max_latency) {
+		max_latency = latency;
+	}
+}
+
+// Forgets the waiting input
+void latency_cancel(void) {
+	pending = FALSE;
+}
+
+// Prints the latency statistics
+void latency_report(void) {
+	clear_report_area();
+	if(samples == 0) {
+		term_put_string_P(PSTR("Latency: no samples"));
+		return;
+	}
+
+	// Find the bucket holding the 99th percentile sample
+	uint16_t target = samples - samples/100;
+	uint16_t seen = 0;
+	uint8_t p99 = 0;
+	for(p99 = 0; p99 < LATENCY_BUCKETS - 1; p99++) {
+		seen += histogram[p99];
+		if(seen >= target) {
+			break;
+		}
+	}
+
+	term_put_string_P(PSTR("Latency (us): n="));
+	term_put_unsigned(samples, 0);
+	term_put_string_P(PSTR(" min="));
+	term_put_unsigned(min_latency * US_PER_TICK, 0);
+	term_put_string_P(PSTR(" avg="));
+	term_put_unsigned(total_latency / samples * US_PER_TICK, 0);
+	term_put_string_P(PSTR(" max="));
+	term_put_unsigned(max_latency * US_PER_TICK, 0);
+	term_put_string_P(PSTR(" p99<="));
+	term_put_unsigned(((uint32_t)(p99 + 1) << LATENCY_BUCKET_SHIFT) *
+			US_PER_TICK, 0);
+
+	// One line per non empty bucket
+	uint8_t row = REPORT_FIRST_ROW + 1;
+	for(uint8_t i = 0; i < LATENCY_BUCKETS && row <= REPORT_LAST_ROW; i++) {
+		if(histogram[i]) {
+			move_cursor(1, row++);
+			term_put_unsigned(((uint32_t)i << LATENCY_BUCKET_SHIFT) *
+					US_PER_TICK, 5);
+			term_put_string_P(PSTR(" us: "));
+			term_put_unsigned(histogram[i], 0);
+		}
+	}
+}
+
+// Copies out the summary statistics
+void latency_get_stats(LatencyStats* stats) {
+	stats->samples = samples;
+	if(samples == 0) {
+		stats->min = 0;
+		stats->average = 0;
+		stats->max = 0;
+	} else {
+		stats->min = clamp(min_latency);
+		stats->average = clamp(total_latency / samples);
+		stats->max = clamp(max_latency);
+	}
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Limits a latency to what fits in the summary
+static uint16_t clamp(uint32_t latency) {
+	return latency > UINT16_MAX ? UINT16_MAX : latency;
+}
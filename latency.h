@@ -0,0 +1,65 @@
+/*
+* latency.h
+*
+* Measures the time from an input arriving (in its interrupt handler) to
+* the LED matrix update that draws the frog in its new position. Results
+* are kept in a histogram that can be printed to the terminal.
+*
+*Author: Michael Bossner
+*/
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+// Width of each histogram bucket in fine time units (64 x 8us = 512us)
+#define LATENCY_BUCKET_SHIFT 6
+// Number of histogram buckets. The last bucket collects everything longer.
+#define LATENCY_BUCKETS 64
+
+// Summary of the samples so far. Times are in fine time units (8us) and
+// anything longer than UINT16_MAX is shown as UINT16_MAX.
+typedef struct {
+	uint16_t samples;
+	uint16_t min;
+	uint16_t average;
+	uint16_t max;
+} LatencyStats;
+
+/*
+ * Empties the histogram.
+ */
+void latency_reset(void);
+
+/*
+ * Must be called when an input is about to be acted on with the fine time
+ * stamp (see get_fine_time32()) taken when the input arrived.
+ */
+void latency_input(uint32_t stamp);
+
+/*
+ * Called once the frog has been drawn on the LED matrix. If an input is
+ * waiting to be measured its latency is added to the histogram.
+ */
+void latency_frog_drawn(void);
+
+/*
+ * Forgets the waiting input, e.g. if it didn't cause the frog to be drawn.
+ */
+void latency_cancel(void);
+
+/*
+ * Prints the sample count, min, average, max and 99th percentile latency
+ * along with the non empty histogram buckets in the report area of the
+ * terminal (see clear_report_area()).
+ */
+void latency_report(void);
+
+/*
+ * Copies the summary of the samples so far into stats. min, average and max
+ * are 0 if there are no samples.
+ */
+void latency_get_stats(LatencyStats* stats);
+
+#endif
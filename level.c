@@ -1,218 +1,332 @@
-/*
-* level.c
-*
-* Author: Michael Bossner
-*/
-
-#include "level.h"
-#include "pixel_colour.h"
-#include "serialio.h"
-#include "terminalio.h"
-#include "ledmatrix.h"
-#include "game.h"
-#include "countdown.h"
-#include "audio.h"
-
-#include <stdio.h>
-#include <avr/pgmspace.h>
-#include <avr/interrupt.h>
-
-#define F_CPU 8000000L
-#include <util/delay.h>
-
-////////////////////////////// Global variables ////////////////////////////////
-
-// Indexing for the patterns in the arrays
-#define PATTERN_1 0
-#define PATTERN_2 1
-#define PATTERN_3 2
-#define PATTERN_4 3
-#define PATTERN_5 4
-// Maximum number of patterns stored
-#define MAX_NUM_PATTERNS 5
-
-// Initial speeds for the rows
-#define ROW1_SPEED 1000
-#define ROW2_SPEED 1300
-#define ROW3_SPEED 865
-#define ROW4_SPEED 1225
-#define ROW5_SPEED 1150
-// Number of rows
-#define ROWS 5
-// Number of Vehicle Lanes
-#define NUM_LANES 3
-// Number of Log Channels
-#define NUM_CHANNELS 2
-// The divider to be used on the row speeds at the end of each level.
-// (ROW_SPEED/SPEED_INCREAS)
-#define SPEED_INCREAS 1.3
-
-// A multidimensional array for storing vehicle colours in different patterns
-PixelColour vehicle_colour_list[MAX_NUM_PATTERNS][NUM_LANES] = {
-	{ COLOUR_RED, COLOUR_YELLOW, COLOUR_RED },
-	{ COLOUR_YELLOW, COLOUR_RED, COLOUR_YELLOW },
-	{ COLOUR_RED, COLOUR_YELLOW, COLOUR_YELLOW },
-	{ COLOUR_YELLOW, COLOUR_YELLOW, COLOUR_YELLOW },
-	{ COLOUR_RED, COLOUR_RED, COLOUR_RED }
-};
-
-// A multidimensional array for storing lane data in different patterns
-static uint64_t lane_data_list[MAX_NUM_PATTERNS][NUM_LANES] = {
-	{
-		0b1100001100011000110000011001100011000011000110001100000110011000,
-		0b0011100000111000011100000111000011100001110001110000111000011100,
-		0b0000111100001111000011110000111100001111000001111100001111000111
-	},
-	{
-		0b1100001100011000110011011001100011000011011100001100000110011000,
-		0b0011001100111000011001100111000011100001110001100110111000011100,
-		0b0000111100001111000011101100111100001111000001111100001111000111
-	},
-	{
-		0b1100001100011000111000011001100011000011100000001110000110011000,
-		0b0011110000111000011100000111000011100001110001110000111000011100,
-		0b0000111100001111000011110000111110001111100001111100001111000111
-	},
-	{
-		0b1100001100011000111100011001100011000011000110001111000110011000,
-		0b0011100000111000011111000111000011100001111101110000111000011100,
-		0b0000111100001111000011110000111110000110000001111100001111000111
-	},
-	{
-		0b1110001110011000110000011111100011000011000110001110000110011000,
-		0b0011111000111000011100000111000011110001110001110000111000011100,
-		0b0000111100001111000011110000111111111111000001111100001111000111
-	}
-};
-
-// A multidimensional array for storing log data in different patterns
-static uint32_t log_data_list[MAX_NUM_PATTERNS][NUM_CHANNELS] = {
-	{
-		0b11110001100111000111100011111000,
-		0b11100110111101100001110110011100
-	},
-	{
-		0b11100001100111000111100011111000,
-		0b11100110111101101101110110011000
-	},
-	{
-		0b11111000000111000111100011110000,
-		0b11100110111001100001110110011000
-	},
-	{
-		0b11110001100110000111000011110000,
-		0b11100110111001100001100110011100
-	},
-	{
-		0b11000001100111000111100011111000,
-		0b10000110110001100001100110011100
-	},
-};
-
-// An array for storing row speeds. The speeds will change every level.
-static uint16_t row_speed[ROWS];
-
-// An array that stores the initial row speeds for each row.
-// These values will not change.
-static const uint16_t initial_row_speed[ROWS] = {
-	ROW1_SPEED,
-	ROW2_SPEED,
-	ROW3_SPEED,
-	ROW4_SPEED,
-	ROW5_SPEED
-};
-
-uint8_t pattern;
-uint8_t level;
-
-
-/////////////////// Function Prototypes for Helper Functions ///////////////////
-
-static void levelup(void);
-static void level_v_updater(void);
-
-/////////////////////////////// Public Functions ///////////////////////////////
-
-// Initialises the game for use with levels
-void init_level(void) {
-	pattern = PATTERN_1;
-	level = 1;
-	level_v_updater();
-	for(uint8_t i = 0; i < ROWS; i++) {
-		row_speed[i] = initial_row_speed[i];
-	}
-}
-
-// Returns the current level
-uint8_t get_level(void) {
-	uint8_t return_value = level;
-	return return_value;
-}
-
-// Returns the lane data for the particular lane requested.
-// Depending on the level different patterns will be provided.
-uint64_t get_lane_data(uint8_t lane) {
-	uint64_t return_value = lane_data_list[pattern][lane];
-	return return_value;
-}
-
-// Returns the log data for the particular channel requested.
-// Depending on the level different patterns will be provided.
-uint32_t get_log_data(uint8_t channel) {
-	uint32_t return_value = log_data_list[pattern][channel];
-	return return_value;
-}
-
-// Returns the colours for the vehicles in the particlar lane requested.
-// Depending on the level different colours will be provided.
-PixelColour get_lane_colours(uint8_t lane) {
-	PixelColour return_value = vehicle_colour_list[pattern][lane];
-	return return_value;
-}
-
-// Returns the movement speed for the row requested.
-// Depending on the level differant speeds will be provided
-uint16_t get_row_speed(uint8_t row) {
-	uint16_t return_value = row_speed[row];
-	return return_value;
-}
-
-// Controls the logic for the end of a level and start of a new level
-void level_updater(void) {
-	pause_countdown(TRUE);
-	for(uint8_t i = 0; i < 32; i++) {
-		play_audio(NO_TRACK);
-		_delay_ms(50);
-		if(i%2) {
-			ledmatrix_shift_display_left();
-		}
-	};
-	levelup();
-	level_v_updater();
-}
-
-/////////////////////////////// Private (Helper) Functions /////////////////////
-
-// A helper function that controls most of the end of level features
-static void levelup(void) {
-	if(level > 1) {
-		// reduce time for scroll speeds
-		for(uint8_t i = 0; i < 5; i++) {
-			uint16_t temp = row_speed[i];
-			temp /= SPEED_INCREAS;
-			row_speed[i] = temp;
-		}
-	}
-	if(pattern == PATTERN_5) {
-		pattern = PATTERN_1;
-		} else {
-		pattern++;
-	}
-	level++;
-}
-
-// A helper function that updates the terminal display in regards to levels
-static void level_v_updater(void) {
-	move_cursor(30, 1);
-	printf_P(PSTR("Level: %u"), get_level());
-}
\ No newline at end of file
+/*
+* level.c
+*
+* Author: Michael Bossner
+*/
+
+#include "level.h"
+#include "pixel_colour.h"
+#include "serialio.h"
+#include "terminalio.h"
+#include "status.h"
+#include "ledmatrix.h"
+#include "game.h"
+#include "countdown.h"
+#include "audio.h"
+#include "levelbank.h"
+#include "idle.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Indexing for the patterns in the arrays
+#define PATTERN_1 0
+#define PATTERN_2 1
+#define PATTERN_3 2
+#define PATTERN_4 3
+#define PATTERN_5 4
+// Maximum number of patterns stored
+#define MAX_NUM_PATTERNS 5
+// The background music gets this much faster (percent) every level
+#define MUSIC_TEMPO_STEP 10
+
+// Initial speeds for the rows
+#define ROW1_SPEED 1000
+#define ROW2_SPEED 1300
+#define ROW3_SPEED 865
+#define ROW4_SPEED 1225
+#define ROW5_SPEED 1150
+// Number of rows
+#define ROWS LEVEL_NUM_ROWS
+// Number of Vehicle Lanes
+#define NUM_LANES LEVEL_NUM_LANES
+// Number of Log Channels
+#define NUM_CHANNELS LEVEL_NUM_CHANNELS
+// The divider to be used on the row speeds at the end of each level.
+// (ROW_SPEED/SPEED_INCREAS)
+#define SPEED_INCREAS 1.3
+// River bank pattern. Note that the least significant bit in this
+// pattern (RHS) corresponds to column 0 on the display (LHS).
+#define RIVERBANK 0b1101110111011101
+
+// The compiled in patterns. They keep the current row speeds and all share
+// the same riverbank.
+static const LevelData default_levels[MAX_NUM_PATTERNS] PROGMEM = {
+	{
+		{
+			0b1100001100011000110000011001100011000011000110001100000110011000,
+			0b0011100000111000011100000111000011100001110001110000111000011100,
+			0b0000111100001111000011110000111100001111000001111100001111000111
+		},
+		{
+			0b11110001100111000111100011111000,
+			0b11100110111101100001110110011100
+		},
+		{ COLOUR_RED, COLOUR_YELLOW, COLOUR_RED },
+		{ 0 },
+		RIVERBANK
+	},
+	{
+		{
+			0b1100001100011000110011011001100011000011011100001100000110011000,
+			0b0011001100111000011001100111000011100001110001100110111000011100,
+			0b0000111100001111000011101100111100001111000001111100001111000111
+		},
+		{
+			0b11100001100111000111100011111000,
+			0b11100110111101101101110110011000
+		},
+		{ COLOUR_YELLOW, COLOUR_RED, COLOUR_YELLOW },
+		{ 0 },
+		RIVERBANK
+	},
+	{
+		{
+			0b1100001100011000111000011001100011000011100000001110000110011000,
+			0b0011110000111000011100000111000011100001110001110000111000011100,
+			0b0000111100001111000011110000111110001111100001111100001111000111
+		},
+		{
+			0b11111000000111000111100011110000,
+			0b11100110111001100001110110011000
+		},
+		{ COLOUR_RED, COLOUR_YELLOW, COLOUR_YELLOW },
+		{ 0 },
+		RIVERBANK
+	},
+	{
+		{
+			0b1100001100011000111100011001100011000011000110001111000110011000,
+			0b0011100000111000011111000111000011100001111101110000111000011100,
+			0b0000111100001111000011110000111110000110000001111100001111000111
+		},
+		{
+			0b11110001100110000111000011110000,
+			0b11100110111001100001100110011100
+		},
+		{ COLOUR_YELLOW, COLOUR_YELLOW, COLOUR_YELLOW },
+		{ 0 },
+		RIVERBANK
+	},
+	{
+		{
+			0b1110001110011000110000011111100011000011000110001110000110011000,
+			0b0011111000111000011100000111000011110001110001110000111000011100,
+			0b0000111100001111000011110000111111111111000001111100001111000111
+		},
+		{
+			0b11000001100111000111100011111000,
+			0b10000110110001100001100110011100
+		},
+		{ COLOUR_RED, COLOUR_RED, COLOUR_RED },
+		{ 0 },
+		RIVERBANK
+	}
+};
+
+// The pattern in use, copied from the level bank or default_levels
+static LevelData current;
+
+// An array for storing row speeds. The speeds will change every level.
+static uint16_t row_speed[ROWS];
+
+// An array that stores the initial row speeds for each row.
+// These values will not change.
+static const uint16_t initial_row_speed[ROWS] = {
+	ROW1_SPEED,
+	ROW2_SPEED,
+	ROW3_SPEED,
+	ROW4_SPEED,
+	ROW5_SPEED
+};
+
+uint8_t pattern;
+uint8_t level;
+// Number of times the row speeds have been divided by SPEED_INCREAS. Speeds
+// from an uploaded pattern are sped up by the same amount when it is loaded.
+static uint8_t speed_ups;
+
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+
+static void levelup(void);
+static void level_v_updater(void);
+static void load_pattern(void);
+static uint16_t speed_up(uint16_t speed);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Initialises the game for use with levels
+void init_level(void) {
+	pattern = PATTERN_1;
+	level = 1;
+	speed_ups = 0;
+	level_v_updater();
+	for(uint8_t i = 0; i < ROWS; i++) {
+		row_speed[i] = initial_row_speed[i];
+	}
+	load_pattern();
+}
+
+// Returns the current level
+uint8_t get_level(void) {
+	uint8_t return_value = level;
+	return return_value;
+}
+
+// Sets the level number and updates the terminal
+void set_level(uint8_t new_level) {
+	level = new_level;
+	level_v_updater();
+}
+
+// Returns the pattern currently in use
+uint8_t get_pattern(void) {
+	uint8_t return_value = pattern;
+	return return_value;
+}
+
+// Changes the pattern. Returns FALSE if there is no such pattern.
+uint8_t set_pattern(uint8_t new_pattern) {
+	if(new_pattern >= get_num_patterns()) {
+		return FALSE;
+	}
+	pattern = new_pattern;
+	load_pattern();
+	return TRUE;
+}
+
+// Returns the number of patterns to cycle through
+uint8_t get_num_patterns(void) {
+	uint8_t count = levelbank_count();
+	if(count == 0) {
+		return MAX_NUM_PATTERNS;
+	}
+	return count;
+}
+
+// Loads the current pattern again. The level bank may now have fewer
+// patterns, in which case we start from the first.
+void reload_pattern(void) {
+	if(pattern >= get_num_patterns()) {
+		pattern = PATTERN_1;
+	}
+	load_pattern();
+}
+
+// Changes the speed of a row. Returns FALSE if there is no such row.
+uint8_t set_row_speed(uint8_t row, uint16_t speed) {
+	if(row >= ROWS || speed == 0) {
+		return FALSE;
+	}
+	row_speed[row] = speed;
+	return TRUE;
+}
+
+// Returns the lane data for the particular lane requested.
+// Depending on the level different patterns will be provided.
+uint64_t get_lane_data(uint8_t lane) {
+	uint64_t return_value = current.lanes[lane];
+	return return_value;
+}
+
+// Returns the log data for the particular channel requested.
+// Depending on the level different patterns will be provided.
+uint32_t get_log_data(uint8_t channel) {
+	uint32_t return_value = current.logs[channel];
+	return return_value;
+}
+
+// Returns the colours for the vehicles in the particlar lane requested.
+// Depending on the level different colours will be provided.
+PixelColour get_lane_colours(uint8_t lane) {
+	PixelColour return_value = current.colours[lane];
+	return return_value;
+}
+
+// Returns the riverbank of the pattern in use
+uint16_t get_riverbank(void) {
+	uint16_t return_value = current.riverbank;
+	return return_value;
+}
+
+// Returns the movement speed for the row requested.
+// Depending on the level differant speeds will be provided
+uint16_t get_row_speed(uint8_t row) {
+	uint16_t return_value = row_speed[row];
+	return return_value;
+}
+
+// Controls the logic for the end of a level and start of a new level
+void level_updater(void) {
+	pause_countdown(TRUE);
+	for(uint8_t i = 0; i < 32; i++) {
+		idle_delay(50);
+		if(i%2) {
+			ledmatrix_shift_display_left();
+		}
+	};
+	levelup();
+	level_v_updater();
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// A helper function that controls most of the end of level features
+static void levelup(void) {
+	if(level > 1) {
+		// reduce time for scroll speeds
+		for(uint8_t i = 0; i < 5; i++) {
+			uint16_t temp = row_speed[i];
+			temp /= SPEED_INCREAS;
+			row_speed[i] = temp;
+		}
+		speed_ups++;
+	}
+	if(pattern >= get_num_patterns() - 1) {
+		pattern = PATTERN_1;
+		} else {
+		pattern++;
+	}
+	load_pattern();
+	level++;
+}
+
+// A helper function that updates the terminal display in regards to levels
+// and speeds the music up to suit.
+static void level_v_updater(void) {
+	status_set(STATUS_LEVEL, get_level());
+	uint16_t tempo = 100;
+	if(level > 1) {
+		tempo += (level - 1) * MUSIC_TEMPO_STEP;
+	}
+	set_music_tempo(tempo > 255 ? 255 : tempo);
+}
+
+// A helper function that copies the pattern in use into RAM. Patterns come
+// from the level bank when one has been uploaded. A bank pattern that fails
+// its CRC check is replaced with a compiled in one. The speeds of a bank
+// pattern are the speeds for level 1 and are sped up to suit the level.
+static void load_pattern(void) {
+	if(pattern >= levelbank_count() || !levelbank_load(pattern, &current)) {
+		memcpy_P(&current, &default_levels[pattern % MAX_NUM_PATTERNS],
+				sizeof(current));
+	}
+	for(uint8_t i = 0; i < ROWS; i++) {
+		if(current.speeds[i] != 0) {
+			row_speed[i] = speed_up(current.speeds[i]);
+		}
+	}
+}
+
+// Divides a speed by SPEED_INCREAS once for each level that has sped up
+static uint16_t speed_up(uint16_t speed) {
+	for(uint8_t i = 0; i < speed_ups; i++) {
+		speed /= SPEED_INCREAS;
+	}
+	return speed ? speed : 1;
+}
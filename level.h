@@ -1,58 +1,111 @@
-/*
-* level.h
-*
-* Author: Michael Bossner
-*/
-
-#ifndef LEVEL_H_
-#define LEVEL_H_
-
-#include <stdint.h>
-#include "pixel_colour.h"
-
-// Macros for the get_row_speed() indexing
-#define FIRST_VEHICLE_ROW_SPEED 0
-#define SECOND_VEHICLE_ROW_SPEED 1
-#define THIRD_VEHICLE_ROW_SPEED 2
-#define FIRST_RIVER_ROW_SPEED 3
-#define SECOND_RIVER_ROW_SPEED 4
-#define RIVERBANK_ROW_SPEED 7
-
-/*
- * Initialises the game ready for use with levels.
- * Must be called first for levels to function properly.
- */
-void init_level(void);
-
-/*
- * Adds one to the level and updates the level number on the terminal.
- */
-void level_updater(void);
-
-/*
- * Returns the current level.
- */
-uint8_t get_level(void);
-
-/*
- * Returns the lane data for the requested lane.
- */
-uint64_t get_lane_data(uint8_t lane);
-
-/*
- * Returns the log data for the requested channel
- */
-uint32_t get_log_data(uint8_t channel);
-
-/*
- * Returns the colour for the vehicles in the requested lane
- */
-PixelColour get_lane_colours(uint8_t lane);
-
-/*
- * Returns the speed at which the requested row will shift at
- */
-uint16_t get_row_speed(uint8_t row);
-
-#endif
+/*
+* level.h
+*
+* Author: Michael Bossner
+*/
+
+#ifndef LEVEL_H_
+#define LEVEL_H_
+
+#include <stdint.h>
+#include "pixel_colour.h"
+
+// Macros for the get_row_speed() indexing
+#define FIRST_VEHICLE_ROW_SPEED 0
+#define SECOND_VEHICLE_ROW_SPEED 1
+#define THIRD_VEHICLE_ROW_SPEED 2
+#define FIRST_RIVER_ROW_SPEED 3
+#define SECOND_RIVER_ROW_SPEED 4
+#define RIVERBANK_ROW_SPEED 7
+
+// Number of vehicle lanes, log channels and rows that move
+#define LEVEL_NUM_LANES 3
+#define LEVEL_NUM_CHANNELS 2
+#define LEVEL_NUM_ROWS 5
+
+// Everything that makes up a pattern. Patterns are either compiled in or
+// uploaded into the EEPROM level bank (see levelbank.h), which stores them
+// byte for byte as laid out here (little endian).
+typedef struct {
+	uint64_t lanes[LEVEL_NUM_LANES];	// vehicle bit patterns
+	uint32_t logs[LEVEL_NUM_CHANNELS];	// log bit patterns
+	PixelColour colours[LEVEL_NUM_LANES];	// vehicle colour of each lane
+	uint16_t speeds[LEVEL_NUM_ROWS];	// ms between moves at level 1, 0 = unchanged
+	uint16_t riverbank;	// 1 bits are bank, 0 bits are holes
+} LevelData;
+
+/*
+ * Initialises the game ready for use with levels.
+ * Must be called first for levels to function properly.
+ */
+void init_level(void);
+
+/*
+ * Adds one to the level and updates the level number on the terminal.
+ */
+void level_updater(void);
+
+/*
+ * Returns the current level.
+ */
+uint8_t get_level(void);
+
+/*
+ * Sets the level number (e.g. from the console). Only the number changes -
+ * the pattern and speeds are left alone.
+ */
+void set_level(uint8_t new_level);
+
+/*
+ * Returns or changes the pattern of lanes and logs in use. set_pattern()
+ * returns 0 if there is no such pattern.
+ */
+uint8_t get_pattern(void);
+uint8_t set_pattern(uint8_t new_pattern);
+
+/*
+ * Returns the number of patterns - the number in the level bank if one has
+ * been uploaded, otherwise the number compiled in.
+ */
+uint8_t get_num_patterns(void);
+
+/*
+ * Loads the current pattern again, e.g. after a new level bank has been
+ * uploaded.
+ */
+void reload_pattern(void);
+
+/*
+ * Changes the time in ms between moves of a row (see get_row_speed()).
+ * Returns 0 if there is no such row or the speed is 0.
+ */
+uint8_t set_row_speed(uint8_t row, uint16_t speed);
+
+/*
+ * Returns the lane data for the requested lane.
+ */
+uint64_t get_lane_data(uint8_t lane);
+
+/*
+ * Returns the log data for the requested channel
+ */
+uint32_t get_log_data(uint8_t channel);
+
+/*
+ * Returns the colour for the vehicles in the requested lane
+ */
+PixelColour get_lane_colours(uint8_t lane);
+
+/*
+ * Returns the riverbank of the current pattern. Bit n is column n and is 1
+ * for bank and 0 for a hole.
+ */
+uint16_t get_riverbank(void);
+
+/*
+ * Returns the speed at which the requested row will shift at
+ */
+uint16_t get_row_speed(uint8_t row);
+
+#endif
  
\ No newline at end of file
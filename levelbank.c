@@ -0,0 +1,261 @@
+/*
+* levelbank.c
+*
+* Author: Michael Bossner
+*/
+
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+
+#include "levelbank.h"
+#include "serialio.h"
+#include "terminalio.h"
+#include "console.h"
+#include "storage.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Upload frame types
+#define FRAME_BEGIN 'B'
+#define FRAME_LEVEL 'L'
+#define FRAME_END 'E'
+
+// Length of each frame (type, arguments and CRC)
+#define BEGIN_LENGTH 3
+#define LEVEL_LENGTH (2 + sizeof(LevelData) + 1)
+#define END_LENGTH 2
+
+// The bank is only used if the signature is set. The header holds the
+// number of patterns then the signature, so the signature is written last.
+#define BANK_SIGNATURE 0x4C
+#define HEADER_COUNT 0
+#define HEADER_SIGNATURE 1
+static uint8_t EEMEM bank_header[2];
+// Each pattern is stored followed by the CRC-8 of its bytes
+static uint8_t EEMEM bank_levels[LEVELBANK_SIZE][sizeof(LevelData) + 1];
+
+// The frame being received. Patterns are written to EEPROM straight from
+// here, so no more bytes are read until the write has finished.
+static uint8_t frame[LEVEL_LENGTH];
+static uint8_t frame_length;
+static uint8_t frame_overflow;
+// COBS decoder state - the last code byte and the bytes left in its block
+static uint8_t cobs_code;
+static uint8_t cobs_left;
+
+static uint8_t uploading;
+// Patterns expected and a bit for each that has arrived
+static uint8_t expected;
+static uint8_t received;
+
+// Type of the frame being written to EEPROM (0 if none). The write is done
+// in the background (see storage.h) and the frame is answered once
+// write_done() has cleared writing.
+static uint8_t write_frame;
+static volatile uint8_t writing;
+static uint8_t header[2];
+// Written over the signature to stop the bank being used
+static const uint8_t no_signature = 0xFF;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+
+static void receive_byte(uint8_t byte);
+static void store_byte(uint8_t byte);
+static void process_frame(void);
+static void start_write(const uint8_t* source, uint8_t* dest, uint8_t length);
+static void write_done(void);
+static void reply(uint8_t ok, uint8_t type);
+static uint8_t crc8(const uint8_t* data, uint8_t length);
+static uint8_t riverbank_valid(const LevelData* data);
+static void reset_decoder(void);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+uint8_t levelbank_count(void) {
+	uint8_t stored[2];
+	storage_read(stored, bank_header, sizeof(stored));
+	if(stored[HEADER_SIGNATURE] != BANK_SIGNATURE ||
+			stored[HEADER_COUNT] > LEVELBANK_SIZE) {
+		return 0;
+	}
+	return stored[HEADER_COUNT];
+}
+
+uint8_t levelbank_load(uint8_t index, LevelData* data) {
+	uint8_t crc;
+	storage_read(data, bank_levels[index], sizeof(LevelData));
+	storage_read(&crc, &bank_levels[index][sizeof(LevelData)], 1);
+	return crc8((const uint8_t*)data, sizeof(LevelData)) == crc &&
+			riverbank_valid(data);
+}
+
+void levelbank_clear(void) {
+	storage_write(&bank_header[HEADER_SIGNATURE], &no_signature, 1, 0);
+}
+
+void levelbank_start_upload(void) {
+	uploading = 1;
+	expected = 0;
+	received = 0;
+	write_frame = 0;
+	reset_decoder();
+	serial_set_raw_input(1);
+}
+
+void levelbank_abort(void) {
+	// Let the write in progress finish - the signature was cleared before
+	// any pattern was written so the partial bank is never used
+	storage_flush();
+	write_frame = 0;
+	uploading = 0;
+	serial_set_raw_input(0);
+}
+
+uint8_t levelbank_uploading(void) {
+	return uploading;
+}
+
+uint8_t levelbank_update(void) {
+	if(write_frame) {
+		if(writing) {
+			return 0;
+		}
+		reply(1, write_frame);
+		if(write_frame == FRAME_END) {
+			write_frame = 0;
+			uploading = 0;
+			serial_set_raw_input(0);
+			return 1;
+		}
+		write_frame = 0;
+	}
+	// Read until a frame needs writing to EEPROM
+	int16_t byte;
+	while(!write_frame && (byte = serial_read_byte()) >= 0) {
+		receive_byte(byte);
+	}
+	return 0;
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Decodes one COBS byte. A zero byte ends the frame.
+static void receive_byte(uint8_t byte) {
+	if(byte == 0) {
+		if(frame_length != 0 && cobs_left == 0 && !frame_overflow) {
+			process_frame();
+		}
+		reset_decoder();
+		return;
+	}
+	if(cobs_left == 0) {
+		// A code byte. The block before it ended with a zero unless this is
+		// the first block or the one before was full (code 0xFF).
+		if(cobs_code != 0xFF) {
+			store_byte(0);
+		}
+		cobs_code = byte;
+		cobs_left = byte - 1;
+	} else {
+		store_byte(byte);
+		cobs_left--;
+	}
+}
+
+static void store_byte(uint8_t byte) {
+	if(frame_length < sizeof(frame)) {
+		frame[frame_length++] = byte;
+	} else {
+		frame_overflow = 1;
+	}
+}
+
+// Checks a whole frame and starts writing it to EEPROM. Frames that can't be
+// used are answered straight away.
+static void process_frame(void) {
+	uint8_t length = frame_length - 1;
+	if(crc8(frame, length) != frame[length]) {
+		reply(0, frame[0]);
+		return;
+	}
+	switch(frame[0]) {
+		case FRAME_BEGIN:
+			if(frame_length != BEGIN_LENGTH || frame[1] == 0 ||
+					frame[1] > LEVELBANK_SIZE) {
+				break;
+			}
+			expected = frame[1];
+			received = 0;
+			// Stop using the stored bank before it is overwritten
+			header[HEADER_SIGNATURE] = 0xFF;
+			start_write(&header[HEADER_SIGNATURE],
+					&bank_header[HEADER_SIGNATURE], 1);
+			return;
+		case FRAME_LEVEL:
+			if(frame_length != LEVEL_LENGTH || frame[1] >= expected ||
+					!riverbank_valid((const LevelData*)&frame[2])) {
+				break;
+			}
+			received |= 1 << frame[1];
+			// Store the CRC of the pattern alone in place of the frame CRC
+			frame[LEVEL_LENGTH - 1] = crc8(&frame[2], sizeof(LevelData));
+			start_write(&frame[2], bank_levels[frame[1]],
+					sizeof(LevelData) + 1);
+			return;
+		case FRAME_END:
+			if(frame_length != END_LENGTH || expected == 0 ||
+					received != (uint8_t)((1 << expected) - 1)) {
+				break;
+			}
+			header[HEADER_COUNT] = expected;
+			header[HEADER_SIGNATURE] = BANK_SIGNATURE;
+			start_write(header, bank_header, sizeof(header));
+			return;
+		default:
+			break;
+	}
+	reply(0, frame[0]);
+}
+
+static void start_write(const uint8_t* source, uint8_t* dest, uint8_t length) {
+	write_frame = frame[0];
+	writing = 1;
+	storage_write(dest, source, length, write_done);
+}
+
+// Called from the EEPROM interrupt handler once the write has finished
+static void write_done(void) {
+	writing = 0;
+}
+
+// Answers a frame on the console output row
+static void reply(uint8_t ok, uint8_t type) {
+	move_cursor(1, CONSOLE_OUTPUT_ROW);
+	clear_to_end_of_line();
+	term_put_string_P(PSTR("Upload "));
+	term_put_string_P(ok ? PSTR("OK ") : PSTR("ERR "));
+	serial_put_char((type >= ' ' && type <= '~') ? type : '?');
+	serial_put_char('\n');
+}
+
+static uint8_t crc8(const uint8_t* data, uint8_t length) {
+	uint8_t crc = 0;
+	for(uint8_t i = 0; i < length; i++) {
+		crc = _crc8_ccitt_update(crc, data[i]);
+	}
+	return crc;
+}
+
+// A riverbank with no holes can't be filled and one with no bank needs
+// a frog in every column
+static uint8_t riverbank_valid(const LevelData* data) {
+	return data->riverbank != 0 && data->riverbank != 0xFFFF;
+}
+
+static void reset_decoder(void) {
+	frame_length = 0;
+	frame_overflow = 0;
+	cobs_code = 0xFF;
+	cobs_left = 0;
+}
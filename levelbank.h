@@ -0,0 +1,73 @@
+/*
+* levelbank.h
+*
+* A bank of patterns (see LevelData in level.h) kept in EEPROM and uploaded
+* over the serial port. While a bank is stored the game cycles through its
+* patterns instead of the compiled in ones.
+*
+* Uploads are COBS framed like telemetry (see serialio.h): each frame is a
+* payload followed by its CRC-8 (polynomial 0x07) and a zero byte. Payloads:
+*	'B' count		start an upload of count patterns (1 to LEVELBANK_SIZE).
+*				The stored bank is thrown away.
+*	'L' index data		pattern index (0 to count - 1), data is the LevelData
+*				bytes. The riverbank needs a hole and a bank.
+*	'E'			finish. Only accepted once every pattern has arrived.
+* After each frame "Upload OK" or "Upload ERR" is printed on the console
+* output row. Frames that are written to EEPROM are only answered once the
+* write has finished, so wait for the answer before sending the next frame.
+* tools/level_upload.py does all of this.
+*
+*Author: Michael Bossner
+*/
+
+#ifndef LEVELBANK_H_
+#define LEVELBANK_H_
+
+#include <stdint.h>
+#include "level.h"
+
+// Most patterns the bank holds
+#define LEVELBANK_SIZE 8
+
+/*
+ * Returns the number of patterns in the bank or 0 if there is no bank.
+ */
+uint8_t levelbank_count(void);
+
+/*
+ * Copies pattern index from the bank into data. Returns 0 if the stored
+ * pattern fails its CRC check or its riverbank can't be played.
+ */
+uint8_t levelbank_load(uint8_t index, LevelData* data);
+
+/*
+ * Throws away the stored bank so the compiled in patterns are used.
+ */
+void levelbank_clear(void);
+
+/*
+ * Starts waiting for an upload. The serial port is switched to raw input
+ * until the upload finishes or is cancelled.
+ */
+void levelbank_start_upload(void);
+
+/*
+ * Cancels an upload. A partly uploaded bank is not used.
+ */
+void levelbank_abort(void);
+
+/*
+ * Returns non-zero while an upload is running.
+ */
+uint8_t levelbank_uploading(void);
+
+/*
+ * Reads any upload bytes that have arrived. A complete frame is queued with
+ * storage_write() and written by the EEPROM interrupt handler, and reading
+ * stops until its completion callback runs and the frame is acknowledged,
+ * so this never waits. Called every time through the main loop during an
+ * upload. Returns non-zero once when a new bank has been stored.
+ */
+uint8_t levelbank_update(void);
+
+#endif /* LEVELBANK_H_ */
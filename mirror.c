@@ -0,0 +1,184 @@
+/*
+* mirror.c
+*
+* Author: Michael Bossner
+*/
+
+#include <avr/pgmspace.h>
+
+#include "mirror.h"
+#include "ledmatrix.h"
+#include "terminalio.h"
+#include "serialio.h"
+#include "timer0.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Terminal colours a pixel can be shown in (added to BG_BLACK)
+#define MIRROR_BLACK 0
+#define MIRROR_RED 1
+#define MIRROR_GREEN 2
+#define MIRROR_YELLOW 3
+
+// Cells are sent at most every MIRROR_PERIOD ms and then only while more
+// than MIRROR_MIN_FREE bytes of the serial output buffer are free, which
+// leaves room for the status line. At most MIRROR_MAX_CELLS go each time.
+#define MIRROR_PERIOD 40
+#define MIRROR_MIN_FREE (OUTPUT_BUFFER_SIZE / 2)
+#define MIRROR_MAX_CELLS 32
+
+// Terminal colour of each pixel, two pixels per byte (even x in the low
+// nibble)
+static uint8_t cells[MATRIX_NUM_ROWS][MATRIX_NUM_COLUMNS / 2];
+// Bit x of dirty[y] is set if the pixel isn't showing on the terminal yet
+static uint16_t dirty[MATRIX_NUM_ROWS];
+
+static uint8_t enabled;
+static uint32_t last_update;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+
+static uint8_t terminal_colour(PixelColour colour);
+static void set_cell(uint8_t x, uint8_t y, uint8_t colour);
+static void erase_mirror(void);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Records a pixel
+void mirror_pixel(uint8_t x, uint8_t y, PixelColour colour) {
+	set_cell(x, y, terminal_colour(colour));
+}
+
+// Moves every pixel by dx columns and dy rows. Pixels moved in from outside
+// the matrix are black.
+void mirror_shift(int8_t dx, int8_t dy) {
+	for(uint8_t i = 0; i < MATRIX_NUM_ROWS; i++) {
+		// Work from the edge the pixels move towards so each pixel is read
+		// before it is overwritten
+		uint8_t y = (dy > 0) ? MATRIX_NUM_ROWS - 1 - i : i;
+		for(uint8_t j = 0; j < MATRIX_NUM_COLUMNS; j++) {
+			uint8_t x = (dx > 0) ? MATRIX_NUM_COLUMNS - 1 - j : j;
+			int8_t from_x = x - dx;
+			int8_t from_y = y - dy;
+			uint8_t colour = MIRROR_BLACK;
+			if(from_x >= 0 && from_x < MATRIX_NUM_COLUMNS &&
+					from_y >= 0 && from_y < MATRIX_NUM_ROWS) {
+				colour = mirror_get(from_x, from_y);
+			}
+			set_cell(x, y, colour);
+		}
+	}
+}
+
+// Sets every pixel to black
+void mirror_clear(void) {
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			set_cell(x, y, MIRROR_BLACK);
+		}
+	}
+}
+
+// Returns the recorded terminal colour of a pixel
+uint8_t mirror_get(uint8_t x, uint8_t y) {
+	return (cells[y][x / 2] >> ((x & 1) ? 4 : 0)) & 0x0F;
+}
+
+// Marks every cell changed
+void mirror_redraw(void) {
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		dirty[y] = 0xFFFF;
+	}
+}
+
+// Turns the mirror on (drawing all of it) or off (erasing it)
+void mirror_toggle(void) {
+	enabled = !enabled;
+	if(enabled) {
+		mirror_redraw();
+	} else {
+		erase_mirror();
+	}
+}
+
+// Sends changed cells, top row first, within the rate limits
+void mirror_update(void) {
+	uint32_t now = get_loop_time();
+	if(!enabled || now - last_update < MIRROR_PERIOD) {
+		return;
+	}
+	last_update = now;
+
+	uint8_t saved_attribute = get_display_attribute();
+	uint8_t colour_sent = 0xFF;
+	uint8_t sent = 0;
+	for(int8_t y = MATRIX_NUM_ROWS - 1; y >= 0 && sent < MIRROR_MAX_CELLS; y--) {
+		// Column after the last cell sent on this row or -1
+		int8_t cursor_x = -1;
+		for(uint8_t x = 0; x < MATRIX_NUM_COLUMNS; x++) {
+			if(!(dirty[y] & (1U << x))) {
+				continue;
+			}
+			if(sent >= MIRROR_MAX_CELLS ||
+					serial_tx_free() <= MIRROR_MIN_FREE) {
+				sent = MIRROR_MAX_CELLS;
+				break;
+			}
+			if(cursor_x != x) {
+				move_cursor(MIRROR_X + 2*x, MIRROR_Y + MATRIX_NUM_ROWS - 1 - y);
+			}
+			uint8_t colour = mirror_get(x, y);
+			if(colour != colour_sent) {
+				set_display_attribute(BG_BLACK + colour);
+				colour_sent = colour;
+			}
+			term_put_string_P(PSTR("  "));
+			dirty[y] &= ~(1U << x);
+			cursor_x = x + 1;
+			sent++;
+		}
+	}
+	if(colour_sent != 0xFF) {
+		// Take the background colour off again
+		normal_display_mode();
+		if(saved_attribute != TERM_RESET) {
+			set_display_attribute(saved_attribute);
+		}
+	}
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Picks the terminal colour closest to a matrix colour (green in the high
+// nibble, red in the low nibble). Mixes with one part well over twice the
+// other count as that part, anything else lit is yellow.
+static uint8_t terminal_colour(PixelColour colour) {
+	uint8_t red = colour & 0x0F;
+	uint8_t green = colour >> 4;
+	if(red == 0 && green == 0) {
+		return MIRROR_BLACK;
+	} else if(red > 2*green) {
+		return MIRROR_RED;
+	} else if(green > 2*red) {
+		return MIRROR_GREEN;
+	}
+	return MIRROR_YELLOW;
+}
+
+// Stores a pixel's terminal colour and marks it changed if it is different
+static void set_cell(uint8_t x, uint8_t y, uint8_t colour) {
+	uint8_t shift = (x & 1) ? 4 : 0;
+	uint8_t* cell = &cells[y][x / 2];
+	if(((*cell >> shift) & 0x0F) != colour) {
+		*cell = (*cell & ~(0x0F << shift)) | (colour << shift);
+		dirty[y] |= (1U << x);
+	}
+}
+
+// Blanks the mirror's rows of the terminal
+static void erase_mirror(void) {
+	for(uint8_t y = 0; y < MATRIX_NUM_ROWS; y++) {
+		move_cursor(MIRROR_X, MIRROR_Y + y);
+		clear_to_end_of_line();
+	}
+}
@@ -0,0 +1,61 @@
+/*
+* mirror.h
+*
+* Optional copy of the LED matrix on the terminal for when the matrix is hard
+* to see. Each pixel is drawn as a pair of spaces with a background colour.
+* ledmatrix.c passes every pixel it sends to the matrix on to mirror_pixel()
+* which only records it - mirror_update() sends the cells that changed, a few
+* at a time, so the mirror never holds up the matrix or the status line.
+*
+*Author: Michael Bossner
+*/
+
+#ifndef MIRROR_H_
+#define MIRROR_H_
+
+#include <stdint.h>
+#include "pixel_colour.h"
+
+// Terminal position of the top left of the mirror. Each pixel is 2 columns
+// wide so it takes up 32 columns and 8 rows.
+#define MIRROR_X 1
+#define MIRROR_Y 4
+
+/*
+ * Records the colour of a matrix pixel (x from 0 to 15, y from 0 to 7 bottom
+ * to top).
+ */
+void mirror_pixel(uint8_t x, uint8_t y, PixelColour colour);
+
+/*
+ * Moves every recorded pixel by dx columns and dy rows (as the matrix shift
+ * commands do) or sets them all to black.
+ */
+void mirror_shift(int8_t dx, int8_t dy);
+void mirror_clear(void);
+
+/*
+ * Returns the colour recorded for a pixel as one of the terminal colours
+ * (0 black, 1 red, 2 green, 3 yellow).
+ */
+uint8_t mirror_get(uint8_t x, uint8_t y);
+
+/*
+ * Marks every cell as changed so the whole mirror is drawn again. Must be
+ * called after the terminal is cleared.
+ */
+void mirror_redraw(void);
+
+/*
+ * Turns the mirror on or off. It is off to start with. Turning it off blanks
+ * its rows of the terminal.
+ */
+void mirror_toggle(void);
+
+/*
+ * Sends some of the changed cells if the mirror is on. Called every time
+ * through the game loop.
+ */
+void mirror_update(void);
+
+#endif /* MIRROR_H_ */
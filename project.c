@@ -1,353 +1,535 @@
-/*
- * FroggerProject.c
- *
- * Main file
- *
- * Author: Peter Sutton. Modified by Michael Bossner
- */
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <avr/pgmspace.h>
-#include <stdio.h>
-
-#include "ledmatrix.h"
-#include "scrolling_char_display.h"
-#include "buttons.h"
-#include "serialio.h"
-#include "terminalio.h"
-#include "score.h"
-#include "timer0.h"
-#include "game.h"
-#include "level.h"
-#include "life.h"
-#include "countdown.h"
-#include "audio.h"
-#include "joystick.h"
-#include "highscore.h"
-
-#define F_CPU 8000000L
-#include <util/delay.h>
-
-// ASCII code for Escape character
-#define ESCAPE_CHAR 27
-
-static uint32_t current_time, lmt_lane_0, lmt_lane_1, lmt_lane_2, lmt_channel_0,
-lmt_channel_1, button_repeat_time;
-
-static char serial_input, escape_sequence_char;
-static uint8_t characters_into_escape_sequence = 0;
-int8_t button = NO_BUTTON_PUSHED;
-int8_t joystick = NO_BUTTON_PUSHED;
-#define BUTTON_REPEAT 250
-
-// Function prototypes - these are defined below (after main()) in the order
-// given here
-void initialise_hardware(void);
-void splash_screen(void);
-void new_game(void);
-void play_game(void);
-void handle_game_over(void);
-
-/////////////////////////////// Private (Helper) Functions /////////////////////
-static void move_lanes(void);
-static void process_serial_in(void);
-static void process_input(void);
-static void process_diagonal_move(void);
-
-/////////////////////////////// main //////////////////////////////////
-int main(void) {
-	// Setup hardware and call backs. This will turn on
-	// interrupts.
-	initialise_hardware();
-
-	// Show the splash screen message. Returns when display
-	// is complete
-	splash_screen();
-
-	while(1) {
-		new_game();
-		play_game();
-		handle_game_over();
-	}
-}
-
-void initialise_hardware(void) {
-	ledmatrix_setup();
-	init_button_interrupts();
-	// Setup serial port for 19200 baud communication with no echo
-	// of incoming characters
-	init_serial_stdio(19200,0);
-	init_timer0();
-	init_audio();
-	init_highscore();
-	init_joystick();
-
-	// Turn on global interrupts
-	sei();
-}
-
-void splash_screen(void) {
-	// Clear terminal screen and output a message
-	clear_terminal();
-	set_display_attribute(FG_GREEN);
-	draw_highscore_screen();
-	move_cursor(37,2);
-	printf_P(PSTR("Frogger"));
-	move_cursor(16,3);
-	printf_P(PSTR("CSSE2010/7201 project by Michael Bossner S4427719"));
-
-	// Output the scrolling message to the LED matrix
-	// and wait for a push button to be pushed.
-	ledmatrix_clear();
-	while(1) {
-		set_scrolling_display_text("FROGGER   S4427719", COLOUR_GREEN);
-		// Scroll the message until it has scrolled off the
-		// display or a button is pushed
-		while(scroll_display()) {
-			_delay_ms(150);
-			if(button_pushed() != NO_BUTTON_PUSHED) {
-				return;
-			}
-		}
-	}
-}
-
-void new_game(void) {
-	// Clear the serial terminal
-	clear_terminal();
-	hide_cursor();
-
-	// Initialise the game and display
-	initialise_game();
-
-	// Initialise the score
-	init_score();
-	init_lives();
-	init_level();
-	init_countdown();
-
-	// Clear all button pushes or serial inputs if any are waiting
-	clear_button_queue();
-	clear_serial_input_buffer();
-	clear_joystick_queue();
-}
-
-void play_game(void) {
-	// Get the current time and remember this as the last time the vehicles
-	// and logs were moved.
-	current_time = get_current_time();
-	lmt_lane_0 = current_time; // lmt = last move time
-	lmt_lane_1 = current_time;
-	lmt_lane_2 = current_time;
-	lmt_channel_0 = current_time;
-	lmt_channel_1 = current_time;
-	button_repeat_time = current_time;
-
-	// We play the game while the frog is alive
-	while(get_lives() > 0) {
-		if(!is_frog_dead() && frog_has_reached_riverbank()) {
-			// Frog reached the other side successfully but the
-			// riverbank isn't full, put a new frog at the start
-			if(is_riverbank_full()) {
-				play_audio(FROG_LEVELUP);
-				level_updater();
-				initialise_game();
-				add_life();
-			} else {
-				play_audio(FROG_MADE_IT);
-				put_frog_in_start_position();
-			}
-		}
-		// Check for input - which could be a button push or serial input.
-		// Serial input may be part of an escape sequence, e.g. ESC [ D
-		// is a left cursor key press. At most one of the following three
-		// variables will be set to a value other than -1 if input is available.
-		// (We don't initalise button to -1 since button_pushed() will return -1
-		// if no button pushes are waiting to be returned.)
-		// Button pushes take priority over serial input. If there are both then
-		// we'll retrieve the serial input the next time through this loop
-		serial_input = -1;
-		escape_sequence_char = -1;
-
-		joystick = get_joystick_move();
-		if(!joystick) {
-			button = button_pushed();
-			if(button != NO_BUTTON_PUSHED) {
-				button_repeat_time = current_time;
-			}
-
-			if(is_button_held() != NO_BUTTON_PUSHED &&
-					current_time >= button_repeat_time + BUTTON_REPEAT) {
-						button = is_button_held();
-						button_repeat_time = current_time;
-			}
-
-			if(button == NO_BUTTON_PUSHED) {
-				process_serial_in();
-			}
-		}
-
-		else if(joystick >= JOYSTICK_DIAGONAL_MOVE) {
-			process_diagonal_move();
-		}
-		
-		process_input();
-		move_lanes();
-		remove_life();
-		play_audio(NO_TRACK);
-	}
-	// We get here if the frog is out of lives or the riverbank is full
-	// The game is over.
-}
-
-void handle_game_over() {
-	pause_countdown(TRUE);
-	clear_terminal();
-
-	// unused if statement as the player cannot win with infinite levels
-	if(!is_frog_dead()) {
-		move_cursor(37,2);
-		printf_P(PSTR("WINNER!!"));
-		play_audio(WINNER);
-	} else {
-		move_cursor(37,2);
-		printf_P(PSTR("GAME OVER"));
-		play_audio(GAME_OVER);
-	}
-	draw_gameover_screen();
-	
-	clear_button_queue();
-	move_cursor(26,3);
-	printf_P(PSTR("Press a button to start again"));
-	while(button_pushed() == NO_BUTTON_PUSHED) {
-		; // wait
-	}
-}
-
-/////////////////////////////// Private (Helper) Functions /////////////////////
-
-static void move_lanes(void) {
-	current_time = get_current_time();
-	if(!is_frog_dead() && current_time >= lmt_lane_0 +
-	get_row_speed(FIRST_VEHICLE_ROW_SPEED)) {
-		scroll_vehicle_lane(0, 1);
-		lmt_lane_0 = current_time;
-	}
-	if(!is_frog_dead() && current_time >= lmt_lane_1 +
-	get_row_speed(SECOND_VEHICLE_ROW_SPEED)) {
-		scroll_vehicle_lane(1, -1);
-		lmt_lane_1 = current_time;
-	}
-	if(!is_frog_dead() && current_time >= lmt_lane_2 +
-	get_row_speed(THIRD_VEHICLE_ROW_SPEED)) {
-		scroll_vehicle_lane(2, 1);
-		lmt_lane_2 = current_time;
-	}
-	if(!is_frog_dead() && current_time >= lmt_channel_0 +
-	get_row_speed(FIRST_RIVER_ROW_SPEED)) {
-		scroll_river_channel(0, -1);
-		lmt_channel_0 = current_time;
-	}
-	if(!is_frog_dead() && current_time >= lmt_channel_1 +
-	get_row_speed(SECOND_RIVER_ROW_SPEED)) {
-		scroll_river_channel(1, 1);
-		lmt_channel_1 = current_time;
-	}
-}
-
-static void process_serial_in(void) {
-	if(serial_input_available()) {
-		// Serial data was available - read the data from standard input
-		serial_input = fgetc(stdin);
-		// Check if the character is part of an escape sequence
-		if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
-			// We've hit the first character in an escape sequence (escape)
-			characters_into_escape_sequence++;
-			serial_input = -1; // Don't further process this character
-			}
-		else if(characters_into_escape_sequence == 1 && serial_input == '[') {
-			// We've hit the second character in an escape sequence
-			characters_into_escape_sequence++;
-			serial_input = -1; // Don't further process this character
-			}
-		else if(characters_into_escape_sequence == 2) {
-			// Third (and last) character in the escape sequence
-			escape_sequence_char = serial_input;
-			serial_input = -1;  // Don't further process this character - we
-			// deal with it as part of the escape sequence
-			characters_into_escape_sequence = 0;
-			}
-		else {
-			// Character was not part of an escape sequence (or we received
-			// an invalid second character in the sequence). We'll process
-			// the data in the serial_input variable.
-			characters_into_escape_sequence = 0;
-			}
-	}
-}
-
-static void process_input(void) {
-	// Process the input.
-	if(button==3 || escape_sequence_char=='D' || serial_input=='A' ||
-	serial_input=='a' || joystick==MOVE_LEFT) {
-		// Attempt to move left
-		play_audio(FROG_JUMP);
-		move_frog_to_left();
-	} else if(button==2 || escape_sequence_char=='A' || serial_input=='W' ||
-	serial_input=='w' || joystick==MOVE_UP) {
-		// Attempt to move forward
-		play_audio(FROG_JUMP);
-		move_frog_forward();
-	} else if(button==1 || escape_sequence_char=='B' || serial_input=='S' ||
-	serial_input=='s' || joystick==MOVE_DOWN) {
-		// Attempt to move down
-		play_audio(FROG_JUMP);
-		move_frog_backward();
-	} else if(button==0 || escape_sequence_char=='C' || serial_input=='D' ||
-	serial_input=='d' || joystick==MOVE_RIGHT) {
-		// Attempt to move right
-		play_audio(FROG_JUMP);
-		move_frog_to_right();
-	} else if(serial_input == 'p' || serial_input == 'P') {
-		pause_timer(1);
-		pause_countdown(1);
-		uint8_t temp = DDRD;
-		DDRD &= DDRD4_OFF;
-
-		serial_input = -1;
-		while(1) {
-			process_serial_in();
-			if(serial_input == 'p' || serial_input == 'P') {
-				break;
-			}
-		}
-		pause_timer(0);
-		pause_countdown(0);
-		DDRD = temp;
-		clear_button_queue();
-		clear_serial_input_buffer();
-		clear_joystick_queue();
-	}
-	// else - invalid input or we're part way through an escape sequence -
-	// do nothing
-}
-
-static void process_diagonal_move(void) {
-	if(joystick == MOVE_UP_LEFT) {
-		play_audio(FROG_JUMP);
-		move_frog_up_left();
-	}
-	else if(joystick == MOVE_UP_RIGHT) {
-		play_audio(FROG_JUMP);
-		move_frog_up_right();
-	}
-	else if(joystick == MOVE_DOWN_LEFT) {
-		play_audio(FROG_JUMP);
-		move_frog_down_left();
-	}
-	else if(joystick == MOVE_DOWN_RIGHT) {
-		play_audio(FROG_JUMP);
-		move_frog_down_right();
-	}
-}
\ No newline at end of file
+/*
+ * FroggerProject.c
+ *
+ * Main file
+ *
+ * Author: Peter Sutton. Modified by Michael Bossner
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+
+#include "ledmatrix.h"
+#include "scrolling_char_display.h"
+#include "buttons.h"
+#include "serialio.h"
+#include "terminalio.h"
+#include "score.h"
+#include "timer0.h"
+#include "game.h"
+#include "level.h"
+#include "life.h"
+#include "countdown.h"
+#include "audio.h"
+#include "joystick.h"
+#include "highscore.h"
+#include "latency.h"
+#include "keymap.h"
+#include "status.h"
+#include "mirror.h"
+#include "telemetry.h"
+#include "console.h"
+#include "levelbank.h"
+#include "softtimer.h"
+#include "idle.h"
+#include "journal.h"
+
+// Low 16 bits of the game clock when each lane was last moved (lmt = last
+// move time). Compared using 16 bit differences so wrapping doesn't matter.
+static uint16_t lmt_lane_0, lmt_lane_1, lmt_lane_2, lmt_channel_0,
+lmt_channel_1;
+
+// Game state - while paused the lanes, clock and countdown are frozen
+static uint8_t paused;
+// Audio output direction saved while paused
+static uint8_t paused_ddrd;
+
+// Handlers for each game action, indexed by Action (see keymap.h)
+typedef void (*ActionHandler)(void);
+
+// Function prototypes - these are defined below (after main()) in the order
+// given here
+void initialise_hardware(void);
+void splash_screen(void);
+void new_game(void);
+void play_game(void);
+void handle_game_over(void);
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+static void move_lanes(void);
+static void resume_game(void);
+static uint8_t get_input(uint32_t* stamp);
+static uint8_t is_move_key(uint8_t key);
+static void process_input(uint8_t key, uint32_t stamp);
+static void action_none(void);
+static void action_left(void);
+static void action_forward(void);
+static void action_backward(void);
+static void action_right(void);
+static void action_up_left(void);
+static void action_up_right(void);
+static void action_down_left(void);
+static void action_down_right(void);
+static void action_pause(void);
+static void action_latency_report(void);
+static void action_bind(void);
+static void action_serial_report(void);
+static void action_baud_rate(void);
+static void action_mirror(void);
+static void action_telemetry(void);
+static void action_service(void);
+
+static const ActionHandler action_handlers[NUM_ACTIONS] PROGMEM = {
+	[ACTION_NONE] = action_none,
+	[ACTION_LEFT] = action_left,
+	[ACTION_FORWARD] = action_forward,
+	[ACTION_BACKWARD] = action_backward,
+	[ACTION_RIGHT] = action_right,
+	[ACTION_UP_LEFT] = action_up_left,
+	[ACTION_UP_RIGHT] = action_up_right,
+	[ACTION_DOWN_LEFT] = action_down_left,
+	[ACTION_DOWN_RIGHT] = action_down_right,
+	[ACTION_PAUSE] = action_pause,
+	[ACTION_LATENCY_REPORT] = action_latency_report,
+	[ACTION_BIND] = action_bind,
+	[ACTION_SERIAL_REPORT] = action_serial_report,
+	[ACTION_BAUD_RATE] = action_baud_rate,
+	[ACTION_MIRROR] = action_mirror,
+	[ACTION_TELEMETRY] = action_telemetry,
+	[ACTION_SERVICE] = action_service
+};
+
+/////////////////////////////// main //////////////////////////////////
+int main(void) {
+	// Setup hardware and call backs. This will turn on
+	// interrupts.
+	initialise_hardware();
+
+	// Show the splash screen message. Returns when display
+	// is complete
+	splash_screen();
+
+	while(1) {
+		new_game();
+		play_game();
+		handle_game_over();
+	}
+}
+
+void initialise_hardware(void) {
+	ledmatrix_setup();
+	init_buttons();
+	// The saved settings and highscores are found in the journal first
+	init_journal();
+	// Setup serial port with no echo of incoming characters. The baud rate
+	// saved in EEPROM is used unless B0 is held down during reset (in case
+	// the terminal can't be set to the saved rate).
+	if(PINB & (1<<PINB0)) {
+		init_serial_stdio(SERIAL_BAUDRATE,0);
+	} else {
+		init_serial_stdio(serial_saved_baudrate(),0);
+	}
+	init_timer0();
+	init_idle();
+	init_audio();
+	init_highscore();
+	init_joystick();
+	init_keymap();
+	latency_reset();
+
+	// Turn on global interrupts
+	sei();
+}
+
+void splash_screen(void) {
+	// Clear terminal screen and output a message
+	clear_terminal();
+	set_display_attribute(FG_GREEN);
+	draw_highscore_screen();
+	move_cursor(37,2);
+	term_put_string_P(PSTR("Frogger"));
+	move_cursor(16,3);
+	term_put_string_P(PSTR("CSSE2010/7201 project by Michael Bossner S4427719"));
+
+	// Output the scrolling message to the LED matrix
+	// and wait for a push button to be pushed.
+	ledmatrix_clear();
+	while(1) {
+		set_scrolling_display_text("FROGGER   S4427719", COLOUR_GREEN);
+		// Scroll the message until it has scrolled off the
+		// display or a button is pushed
+		while(scroll_display()) {
+			idle_delay(150);
+			if(button_pushed() != NO_BUTTON_PUSHED) {
+				return;
+			}
+		}
+	}
+}
+
+void new_game(void) {
+	// Clear the serial terminal. The status line is shown in green like the
+	// rest of the text.
+	clear_terminal();
+	hide_cursor();
+	screen_set_attribute(FG_GREEN);
+	init_status();
+	mirror_redraw();
+
+	// Load the first pattern before the game is set up from its riverbank
+	init_level();
+
+	// Initialise the game and display
+	initialise_game();
+
+	// Initialise the score
+	init_score();
+	init_lives();
+	init_countdown();
+
+	// Clear all button pushes or serial inputs if any are waiting
+	clear_button_queue();
+	clear_serial_input_buffer();
+	clear_joystick_queue();
+}
+
+void play_game(void) {
+	// Get the current time and remember this as the last time the vehicles
+	// and logs were moved.
+	update_loop_time();
+	uint16_t current_time = get_loop_time();
+	lmt_lane_0 = current_time;
+	lmt_lane_1 = current_time;
+	lmt_lane_2 = current_time;
+	lmt_channel_0 = current_time;
+	lmt_channel_1 = current_time;
+	paused = FALSE;
+	// Never wait for the terminal while playing. Status values are sent when
+	// there is room and other output that doesn't fit is dropped (a whole
+	// escape sequence at a time). The game waits again while paused.
+	serial_set_blocking(0);
+	// Movement keys held down on the terminal repeat like the buttons
+	serial_set_hold_filter(is_move_key);
+	play_music();
+
+	// We play the game while the frog is alive
+	while(get_lives() > 0) {
+		uint32_t stamp;
+		uint8_t key;
+
+		// Everything in this pass uses the same time (see get_loop_time())
+		update_loop_time();
+
+		// Run the work soft timers have left for the main loop (sampling the
+		// joystick and running out of time). idle() does this as well but
+		// the loop doesn't sleep while it is busy.
+		softtimer_run_deferred();
+
+		// Send any changes to the status line to the terminal. The time is
+		// shown in whole seconds, rounded up.
+		status_set(STATUS_TIME, (get_countdown() + 99) / 100);
+		status_update();
+		mirror_update();
+		telemetry_update();
+
+		if(paused && levelbank_uploading()) {
+			// Serial input is upload data until the upload finishes. A
+			// button push cancels it.
+			if(levelbank_update()) {
+				reload_pattern();
+			}
+			if(button_pushed() != NO_BUTTON_PUSHED) {
+				levelbank_abort();
+			}
+			idle();
+			continue;
+		}
+		if(paused) {
+			// Keys typed on the terminal go to the console. Any other input
+			// resumes the game (unless in service mode). Otherwise sleep
+			// until the next interrupt - timer 0 wakes us at least every
+			// millisecond.
+			key = get_input(&stamp);
+			if(key == KEY_NONE) {
+				idle();
+				continue;
+			}
+			uint8_t used = console_key(key);
+			if(used == CONSOLE_RESUME ||
+					(used == CONSOLE_IGNORED && !console_service())) {
+				resume_game();
+			}
+			continue;
+		}
+
+		if(!is_frog_dead() && frog_has_reached_riverbank()) {
+			// Frog reached the other side successfully but the
+			// riverbank isn't full, put a new frog at the start
+			if(is_riverbank_full()) {
+				play_audio(FROG_LEVELUP);
+				level_updater();
+				initialise_game();
+				add_life();
+			} else {
+				play_audio(FROG_MADE_IT);
+				put_frog_in_start_position();
+			}
+		}
+		// Check for input - which could be a joystick move, button push or
+		// serial key - and act on it.
+		key = get_input(&stamp);
+		process_input(key, stamp);
+		move_lanes();
+		remove_life();
+		// Everything else is started by an interrupt (at least the 1ms
+		// tick) so sleep until the next one. Input is checked again
+		// straight away in case more is waiting.
+		if(key == KEY_NONE) {
+			idle();
+		}
+	}
+	// We get here if the frog is out of lives or the riverbank is full
+	// The game is over.
+	stop_music();
+	serial_set_hold_filter(0);
+	serial_set_blocking(1);
+}
+
+void handle_game_over() {
+	pause_countdown(TRUE);
+	clear_terminal();
+
+	// unused if statement as the player cannot win with infinite levels
+	if(!is_frog_dead()) {
+		move_cursor(37,2);
+		term_put_string_P(PSTR("WINNER!!"));
+		play_audio(WINNER);
+	} else {
+		move_cursor(37,2);
+		term_put_string_P(PSTR("GAME OVER"));
+		play_audio(GAME_OVER);
+	}
+	draw_gameover_screen();
+	
+	clear_button_queue();
+	move_cursor(26,3);
+	term_put_string_P(PSTR("Press a button to start again"));
+	while(button_pushed() == NO_BUTTON_PUSHED) {
+		idle();
+	}
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+static void move_lanes(void) {
+	uint16_t current_time = get_loop_time();
+	if(!is_frog_dead() && (uint16_t)(current_time - lmt_lane_0) >=
+	get_row_speed(FIRST_VEHICLE_ROW_SPEED)) {
+		scroll_vehicle_lane(0, 1);
+		lmt_lane_0 = current_time;
+	}
+	if(!is_frog_dead() && (uint16_t)(current_time - lmt_lane_1) >=
+	get_row_speed(SECOND_VEHICLE_ROW_SPEED)) {
+		scroll_vehicle_lane(1, -1);
+		lmt_lane_1 = current_time;
+	}
+	if(!is_frog_dead() && (uint16_t)(current_time - lmt_lane_2) >=
+	get_row_speed(THIRD_VEHICLE_ROW_SPEED)) {
+		scroll_vehicle_lane(2, 1);
+		lmt_lane_2 = current_time;
+	}
+	if(!is_frog_dead() && (uint16_t)(current_time - lmt_channel_0) >=
+	get_row_speed(FIRST_RIVER_ROW_SPEED)) {
+		scroll_river_channel(0, -1);
+		lmt_channel_0 = current_time;
+	}
+	if(!is_frog_dead() && (uint16_t)(current_time - lmt_channel_1) >=
+	get_row_speed(SECOND_RIVER_ROW_SPEED)) {
+		scroll_river_channel(1, 1);
+		lmt_channel_1 = current_time;
+	}
+}
+
+// Returns the keycode of the next input or KEY_NONE if there is none.
+// Joystick moves take priority over button pushes which take priority over
+// serial input. If there are several we'll retrieve the others the next
+// times through the loop. The time stamp of the input is returned in stamp.
+static uint8_t get_input(uint32_t* stamp) {
+	uint8_t move = get_joystick_move();
+	if(move) {
+		*stamp = get_joystick_stamp();
+		return KEY_JOYSTICK(move);
+	}
+	int8_t button = button_pushed();
+	if(button != NO_BUTTON_PUSHED) {
+		*stamp = get_button_stamp();
+		return KEY_BUTTON(button);
+	}
+	uint8_t key = serial_key_pushed();
+	*stamp = serial_key_stamp();
+	return key;
+}
+
+// Returns TRUE if the key moves the frog. Only these keys are treated as held
+// when the terminal resends them (see serial_set_hold_filter()). Keys typed
+// into the console or the rebind prompt all come through.
+static uint8_t is_move_key(uint8_t key) {
+	if(paused || keymap_rebinding()) {
+		return FALSE;
+	}
+	uint8_t action = keymap_action(key);
+	return action >= ACTION_LEFT && action <= ACTION_DOWN_RIGHT;
+}
+
+// Looks up the action bound to the key and runs its handler
+static void process_input(uint8_t key, uint32_t stamp) {
+	if(key == KEY_NONE) {
+		return;
+	}
+	if(keymap_rebinding()) {
+		keymap_rebind_key(key);
+		return;
+	}
+
+	// Carry the time stamp of the input through to the frog being redrawn
+	latency_input(stamp);
+
+	uint8_t action = keymap_action(key);
+	// Telemetry only sends the low 16 bits of the stamp
+	telemetry_input(key, action, (uint16_t)stamp);
+	ActionHandler handler = (ActionHandler)pgm_read_word(
+			&action_handlers[action]);
+	handler();
+
+	// The input didn't redraw the frog
+	latency_cancel();
+}
+
+static void action_none(void) {
+	// invalid input - do nothing
+}
+
+static void action_left(void) {
+	// Attempt to move left
+	play_audio(FROG_JUMP);
+	move_frog_to_left();
+}
+
+static void action_forward(void) {
+	// Attempt to move forward
+	play_audio(FROG_JUMP);
+	move_frog_forward();
+}
+
+static void action_backward(void) {
+	// Attempt to move down
+	play_audio(FROG_JUMP);
+	move_frog_backward();
+}
+
+static void action_right(void) {
+	// Attempt to move right
+	play_audio(FROG_JUMP);
+	move_frog_to_right();
+}
+
+static void action_up_left(void) {
+	play_audio(FROG_JUMP);
+	move_frog_up_left();
+}
+
+static void action_up_right(void) {
+	play_audio(FROG_JUMP);
+	move_frog_up_right();
+}
+
+static void action_down_left(void) {
+	play_audio(FROG_JUMP);
+	move_frog_down_left();
+}
+
+static void action_down_right(void) {
+	play_audio(FROG_JUMP);
+	move_frog_down_right();
+}
+
+// Freezes the game. The main loop sleeps until an input resumes it.
+static void action_pause(void) {
+	paused = TRUE;
+	// Nothing is moving so the console and uploads can wait for the terminal
+	serial_set_blocking(1);
+	pause_timer(1);
+	pause_countdown(1);
+	paused_ddrd = DDRD;
+	DDRD &= DDRD4_OFF;
+	draw_pause_overlay();
+	screen_move(45, 1);
+	screen_put_string_P(PSTR("Paused"));
+	console_open(0);
+}
+
+// Unfreezes the game and removes the pause overlay
+static void resume_game(void) {
+	paused = FALSE;
+	console_close();
+	screen_move(45, 1);
+	screen_put_string_P(PSTR("      "));
+	redraw_game();
+	pause_timer(0);
+	pause_countdown(0);
+	DDRD = paused_ddrd;
+	clear_button_queue();
+	clear_serial_input_buffer();
+	clear_joystick_queue();
+	serial_set_blocking(0);
+}
+
+static void action_latency_report(void) {
+	// Dump the input latency histogram
+	latency_report();
+}
+
+static void action_bind(void) {
+	keymap_start_rebind();
+}
+
+static void action_serial_report(void) {
+	// Show the baud rate error, throughput and buffer statistics
+	serial_report();
+}
+
+static void action_baud_rate(void) {
+	// Save the next baud rate. It only takes effect from the next reset as
+	// the terminal has to be changed to match.
+	long baudrate = serial_next_baudrate();
+	clear_report_area();
+	term_put_string_P(PSTR("Baud rate "));
+	term_put_unsigned(baudrate, 0);
+	term_put_string_P(PSTR(" saved - used after reset"));
+}
+
+static void action_mirror(void) {
+	// Show or hide the copy of the LED matrix on the terminal
+	mirror_toggle();
+}
+
+static void action_telemetry(void) {
+	// Switch between binary telemetry and the terminal UI
+	telemetry_toggle();
+	if(!serial_telemetry()) {
+		// Everything drawn in telemetry mode was thrown away
+		clear_terminal();
+		status_redraw();
+		mirror_redraw();
+	}
+}
+
+static void action_service(void) {
+	// Pause with the console open until it is told to resume
+	if(!paused) {
+		action_pause();
+	}
+	console_open(1);
+}
@@ -0,0 +1,46 @@
+/*
+* repeat.c
+*
+* Author: Michael Bossner
+*/
+
+#include "repeat.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Timing shared by all input sources
+static volatile uint16_t initial_delay = REPEAT_INITIAL_DELAY;
+static volatile uint16_t repeat_rate = REPEAT_RATE;
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Sets the timing used by every input source
+void set_repeat_timing(uint16_t delay, uint16_t rate) {
+	initial_delay = delay;
+	repeat_rate = rate;
+}
+
+// Forgets the held key
+void repeat_reset(RepeatState* state) {
+	state->key = NO_KEY_HELD;
+}
+
+// Remembers a newly pressed key and when its first repeat is due
+void repeat_start(RepeatState* state, int16_t key, uint32_t now) {
+	state->key = key;
+	state->next_repeat = now + initial_delay;
+}
+
+// Returns the held key if it is due to repeat
+int16_t repeat_due(RepeatState* state, int16_t held_key, uint32_t now) {
+	if(held_key != state->key) {
+		// Released, or a different key is held that was never started
+		state->key = NO_KEY_HELD;
+		return NO_KEY_HELD;
+	}
+	if(held_key != NO_KEY_HELD && now >= state->next_repeat) {
+		state->next_repeat = now + repeat_rate;
+		return held_key;
+	}
+	return NO_KEY_HELD;
+}
@@ -0,0 +1,54 @@
+/*
+* repeat.h
+*
+* A shared auto-repeat engine for held inputs. Buttons, joystick directions
+* and held serial keys all repeat with the same initial delay and rate.
+*
+*Author: Michael Bossner
+*/
+
+#ifndef REPEAT_H_
+#define REPEAT_H_
+
+#include <stdint.h>
+
+// No key is currently held
+#define NO_KEY_HELD (-1)
+
+// Default time (ms) a key must be held before it starts to repeat
+#define REPEAT_INITIAL_DELAY 250
+// Default time (ms) between repeats once a key is repeating
+#define REPEAT_RATE 250
+
+// Repeat state for a single input source. Each source keeps its own copy.
+typedef struct {
+	int16_t key;
+	uint32_t next_repeat;
+} RepeatState;
+
+/*
+ * Sets the initial delay and repeat rate (both in ms) used by every input
+ * source.
+ */
+void set_repeat_timing(uint16_t initial_delay, uint16_t rate);
+
+/*
+ * Forgets any key held in the given state.
+ */
+void repeat_reset(RepeatState* state);
+
+/*
+ * Must be called when a key is first pressed. The key will start repeating
+ * once it has been held for the initial delay.
+ */
+void repeat_start(RepeatState* state, int16_t key, uint32_t now);
+
+/*
+ * Should be called regularly with the key that is currently held (or
+ * NO_KEY_HELD). Returns the held key if a repeat is due, otherwise
+ * NO_KEY_HELD. If the held key is not the one last started the repeat is
+ * cancelled.
+ */
+int16_t repeat_due(RepeatState* state, int16_t held_key, uint32_t now);
+
+#endif
@@ -1,18 +1,18 @@
-/*
- * score.h
- * 
- * Author: Peter Sutton
- */
-
-#ifndef SCORE_H_
-#define SCORE_H_
-
-#include <stdint.h>
-
-void init_score(void);
-
-void add_to_score(uint16_t value);
-
-uint32_t get_score(void);
-
+/*
+ * score.h
+ * 
+ * Author: Peter Sutton
+ */
+
+#ifndef SCORE_H_
+#define SCORE_H_
+
+#include <stdint.h>
+
+void init_score(void);
+
+void add_to_score(uint16_t value);
+
+uint32_t get_score(void);
+
 #endif /* SCORE_H_ */
\ No newline at end of file
@@ -1,303 +1,1030 @@
-/*
- * FILE: serialio.c
- *
- * Written by Peter Sutton.
- * 
- * Module to allow standard input/output routines to be used via 
- * serial port 0. The init_serial_stdio() method must be called before
- * any standard IO methods (e.g. printf). We use interrupt-based output
- * and a circular buffer to store output messages. (This allows us 
- * to print many characters at once to the buffer and have them 
- * output by the UART as speed permits.) If the buffer fills up, the
- * put method will either
- * (1) if interrupts are enabled, block until there is room in it, or
- * (2) if interrupts are disabled, will discard the character.
- * Input is blocking - requesting input from stdin will block
- * until a character is available. If interrupts are disabled when 
- * input is sought, then this will block forever.
- * The function input_available() can be used to test whether there is
- * input available to read from stdin.
- *
- */
-
-#include <stdio.h>
-#include <stdint.h>
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-
-/* System clock rate in Hz. (L at the end indicates this is a long constant) */
-#define SYSCLK 8000000L
-
-/* Global variables */
-/* Circular buffer to hold outgoing characters. The insert_pos variable
- * keeps track of the position (0 to OUTPUT_BUFFER_SIZE-1) that the next
- * outgoing character should be written to. bytes_in_buffer keeps
- * count of the number of characters currently stored in the buffer 
- * (ranging from 0 to OUTPUT_BUFFER_SIZE). This number of bytes immediately
- * prior to the current insert_pos are the bytes waiting to be output.
- * If the insert_pos reaches the end of the buffer it will wrap around
- * to the beginning (assuming those bytes have been output).
- * NOTE - OUTPUT_BUFFER_SIZE can not be larger than 255 without changing
- * the type of the variables below (currently defined as 8 bit unsigned ints).
- */
-#define OUTPUT_BUFFER_SIZE 255
-volatile char out_buffer[OUTPUT_BUFFER_SIZE];
-volatile uint8_t out_insert_pos;
-volatile uint8_t bytes_in_out_buffer;
-
-/* Circular buffer to hold incoming characters. Works on same principle
- * as output buffer
- */
-#define INPUT_BUFFER_SIZE 16
-volatile char input_buffer[INPUT_BUFFER_SIZE];
-volatile uint8_t input_insert_pos;
-volatile uint8_t bytes_in_input_buffer;
-volatile uint8_t input_overrun;
-
-/* Variable to keep track of whether incoming characters are to be echoed
- * back or not.
- */
-static int8_t do_echo;
-
-/* Function prototypes 
- */
-void init_serial_stdio(long baudrate, int8_t echo);
-static int uart_put_char(char, FILE*);
-static int uart_get_char(FILE*);
-
-/* Setup a stream that uses the uart get and put functions. We will
- * make standard input and output use this stream below.
- */
-static FILE myStream = FDEV_SETUP_STREAM(uart_put_char, uart_get_char,
-		_FDEV_SETUP_RW);
-
-void init_serial_stdio(long baudrate, int8_t echo) {
-	uint16_t ubrr;
-	/*
-	 * Initialise our buffers
-	*/
-	out_insert_pos = 0;
-	bytes_in_out_buffer = 0;
-	input_insert_pos = 0;
-	bytes_in_input_buffer = 0;
-	input_overrun = 0;
-	
-	/*
-	 * Record whether we're going to echo characters or not
-	*/
-	do_echo = echo;
-	
-	/* Configure the serial port baud rate */
-	/* (This differs from the datasheet formula so that we get 
-	 * rounding to the nearest integer while using integer division
-	 * (which truncates)).
-	*/
-	ubrr = ((SYSCLK / (8 * baudrate)) + 1)/2 - 1;
-	UBRR0 = ubrr;
-	
-	/*
-	 * Enable transmission and receiving via UART. We don't enable
-	 * the UDR empty interrupt here (we wait until we've got a
-	 * character to transmit).
-	 * NOTE: Interrupts must be enabled globally for this
-	 * library to work, but we do not do this here.
-	*/
-	UCSR0B = (1<<RXEN0)|(1<<TXEN0);
-	
-	/*
-	 * Enable receive complete interrupt 
-	*/
-	UCSR0B  |= (1 <<RXCIE0);
-
-	/* Set up our stream so the put and get functions below are used 
-	 * to write/read characters via the serial port when we use
-	 * stdio functions
-	*/
-	stdout = &myStream;
-	stdin = &myStream;
-}
-
-int8_t serial_input_available(void) {
-	return (bytes_in_input_buffer != 0);
-}
-
-void clear_serial_input_buffer(void) {
-	/* Just adjust our buffer data so it looks empty */
-	input_insert_pos = 0;
-	bytes_in_input_buffer = 0;
-}
-
-static int uart_put_char(char c, FILE* stream) {
-	uint8_t interrupts_enabled;
-	
-	/* Add the character to the buffer for transmission (if there 
-	 * is space to do so). If not we wait until the buffer has space.
-	 * If the character is \n, we output \r (carriage return)
-	 * also.
-	*/
-	if(c == '\n') {
-		uart_put_char('\r', stream);
-	}
-	
-	/* If the buffer is full and interrupts are disabled then we
-	 * abort - we don't output the character since the buffer will
-	 * never be emptied if interrupts are disabled. If the buffer is full
-	 * and interrupts are enabled then we loop until the buffer has 
-	 * enough space. The bytes_in_buffer variable will get modified by the
-	 * ISR which extracts bytes from the buffer.
-	*/
-	interrupts_enabled = bit_is_set(SREG, SREG_I);
-	while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
-		if(!interrupts_enabled) {
-			return 1;
-		}		
-		/* else do nothing */
-	}
-	
-	/* Add the character to the buffer for transmission if there
-	 * is space to do so. We advance the insert_pos to the next
-	 * character position. If this is beyond the end of the buffer
-	 * we wrap around back to the beginning of the buffer 
-	 * NOTE: we disable interrupts before modifying the buffer. This
-	 * prevents the ISR from modifying the buffer at the same time.
-	 * We reenable them if they were enabled when we entered the
-	 * function.
-	*/	
-	cli();
-	out_buffer[out_insert_pos++] = c;
-	bytes_in_out_buffer++;
-	if(out_insert_pos == OUTPUT_BUFFER_SIZE) {
-		/* Wrap around buffer pointer if necessary */
-		out_insert_pos = 0;
-	}
-	/* Reenable interrupts (UDR Empty interrupt may have been
-	 * disabled) - we ensure it is now enabled so that it will
-	 * fire and deal with the next character in the buffer. */
-	UCSR0B |= (1 << UDRIE0);
-	if(interrupts_enabled) {
-		sei();
-	}
-	return 0;
-}
-
-int uart_get_char(FILE* stream) {
-	/* Wait until we've received a character */
-	while(bytes_in_input_buffer == 0) {
-		/* do nothing */
-	}
-	
-	/*
-	 * Turn interrupts off and remove a character from the input
-	 * buffer. We reenable interrupts if they were on.
-	 * The pending character is the one which is byte_in_input_buffer
-	 * characters before the insert position (taking into account
-	 * that we may need to wrap around).
-	 */
-	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
-	cli();
-	char c;
-	if(input_insert_pos - bytes_in_input_buffer < 0) {
-		/* Need to wrap around */
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer
-				+ INPUT_BUFFER_SIZE];
-	} else {
-		c = input_buffer[input_insert_pos - bytes_in_input_buffer];
-	}
-	
-	/* Decrement our count of bytes in the input buffer */
-	bytes_in_input_buffer--;
-	if(interrupts_enabled) {
-		sei();
-	}	
-	return c;
-}
-
-/*
- * Define the interrupt handler for UART Data Register Empty (i.e. 
- * another character can be taken from our buffer and written out)
- */
-ISR(USART0_UDRE_vect) 
-{
-	/* Check if we have data in our buffer */
-	if(bytes_in_out_buffer > 0) {
-		/* Yes we do - remove the pending byte and output it
-		 * via the UART. The pending byte (character) is the
-		 * one which is "bytes_in_buffer" characters before the 
-		 * insert_pos (taking into account that we may 
-		 * need to wrap around to the end of the buffer).
-		 */
-		char c;
-		if(out_insert_pos - bytes_in_out_buffer < 0) {
-			/* Need to wrap around */
-			c = out_buffer[out_insert_pos - bytes_in_out_buffer
-				+ OUTPUT_BUFFER_SIZE];
-		} else {
-			c = out_buffer[out_insert_pos - bytes_in_out_buffer];
-		}
-		/* Decrement our count of the number of bytes in the 
-		 * buffer 
-		 */
-		bytes_in_out_buffer--;
-		
-		/* Output the character via the UART */
-		UDR0 = c;
-	} else {
-		/* No data in the buffer. We disable the UART Data
-		 * Register Empty interrupt because otherwise it 
-		 * will trigger again immediately this ISR exits. 
-		 * The interrupt is reenabled when a character is
-		 * placed in the buffer.
-		 */
-		UCSR0B &= ~(1<<UDRIE0);
-	}
-}
-
-/*
- * Define the interrupt handler for UART Receive Complete (i.e. 
- * we can read a character. The character is read and placed in
- * the input buffer.
- */
-
-ISR(USART0_RX_vect) 
-{
-	/* Read the character - we ignore the possibility of overrun. */
-	char c;
-	c = UDR0;
-		
-	if(do_echo && bytes_in_out_buffer < OUTPUT_BUFFER_SIZE) {
-		/* If echoing is enabled and there is output buffer
-		 * space, echo the received character back to the UART.
-		 * (If there is no output buffer space, characters
-		 * will be lost.)
-		 */
-		uart_put_char(c, 0);
-	}
-	
-	/* 
-	 * Check if we have space in our buffer. If not, set the overrun
-	 * flag and throw away the character. (We never clear the 
-	 * overrun flag - it's up to the programmer to check/clear
-	 * this flag if desired.)
-	 */
-	if(bytes_in_input_buffer >= INPUT_BUFFER_SIZE) {
-		input_overrun = 1;
-	} else {
-		/* If the character is a carriage return, turn it into a
-		 * linefeed 
-		*/
-		if (c == '\r') {
-			c = '\n';
-		}
-		
-		/* 
-		 * There is room in the input buffer 
-		 */
-		input_buffer[input_insert_pos++] = c;
-		bytes_in_input_buffer++;
-		if(input_insert_pos == INPUT_BUFFER_SIZE) {
-			/* Wrap around buffer pointer if necessary */
-			input_insert_pos = 0;
-		}
-	}
-}
+/*
+ * FILE: serialio.c
+ *
+ * Written by Peter Sutton.
+ * 
+ * Module to allow standard input/output routines to be used via 
+ * serial port 0. The init_serial_stdio() method must be called before
+ * any standard IO methods (e.g. printf). We use interrupt-based output
+ * and a circular buffer to store output messages. (This allows us 
+ * to print many characters at once to the buffer and have them 
+ * output by the UART as speed permits.) If the buffer fills up, the
+ * put method will either
+ * (1) if interrupts are enabled, block until there is room in it, or
+ * (2) if interrupts are disabled, will discard the character.
+ * Input is blocking - requesting input from stdin will block
+ * until a character is available. If interrupts are disabled when 
+ * input is sought, then this will block forever.
+ * The function input_available() can be used to test whether there is
+ * input available to read from stdin.
+ * Incoming bytes are decoded by a table driven state machine in the
+ * receive interrupt handler. Escape sequences never reach the input
+ * buffer - it only ever holds whole key events (see serialio.h).
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+
+#include "serialio.h"
+#include "timer0.h"
+#include "repeat.h"
+#include "terminalio.h"
+#include "idle.h"
+#include "journal.h"
+
+/* System clock rate in Hz. (L at the end indicates this is a long constant) */
+#define SYSCLK 8000000L
+
+/* Global variables */
+/* Ring buffer to hold outgoing characters. out_head is where the next
+ * outgoing character is written and out_tail is the next character the
+ * UART sends. Both indices run freely and are masked when the buffer is
+ * accessed, so out_head - out_tail is always the number of characters
+ * waiting (0 to OUTPUT_BUFFER_SIZE). The index type only has to be wide
+ * enough to hold the size, so buffers larger than 128 use 16 bit indices.
+ * Only the main program moves the head and only the interrupt handler
+ * moves the tail.
+ */
+#if (OUTPUT_BUFFER_SIZE & (OUTPUT_BUFFER_SIZE - 1)) != 0
+	#error "OUTPUT_BUFFER_SIZE must be a power of two"
+#endif
+#if OUTPUT_BUFFER_SIZE > 128
+typedef uint16_t OutIndex;
+#else
+typedef uint8_t OutIndex;
+#endif
+volatile char out_buffer[OUTPUT_BUFFER_SIZE];
+volatile OutIndex out_head;
+volatile OutIndex out_tail;
+
+/* Ring buffer to hold incoming key events. Works on same principle
+ * as output buffer except the interrupt handler moves the head and the
+ * main program moves the tail.
+ */
+#if (INPUT_BUFFER_SIZE & (INPUT_BUFFER_SIZE - 1)) != 0
+	#error "INPUT_BUFFER_SIZE must be a power of two"
+#endif
+#if INPUT_BUFFER_SIZE > 128
+typedef uint16_t InIndex;
+#else
+typedef uint8_t InIndex;
+#endif
+volatile uint8_t input_buffer[INPUT_BUFFER_SIZE];
+/* Fine time stamp (see get_fine_time32()) of each key in the input buffer */
+volatile uint32_t input_stamps[INPUT_BUFFER_SIZE];
+volatile InIndex input_head;
+volatile InIndex input_tail;
+
+/* Buffer statistics (see serial_get_stats()) */
+static volatile SerialStats stats;
+/* Time (ms) the statistics were last cleared */
+static uint32_t stats_since;
+
+/* Baud rate asked for and the UBRR0/U2X0 setting chosen for it */
+static long requested_baudrate;
+static uint16_t baud_ubrr;
+static uint8_t baud_u2x;
+
+/* Rates serial_next_baudrate() cycles through. Only rates within about 2%
+ * at 8MHz are listed - 115200 is 3.5% out even with U2X0, which is more
+ * than the two ends of the line can tolerate between them. */
+static const uint32_t supported_baudrates[] PROGMEM = {
+	19200, 38400, 57600, 250000
+};
+
+/* Errors (in tenths of a percent) above this are marked in the report */
+#define BAUD_ERROR_LIMIT 20
+#define NUM_BAUDRATES (sizeof(supported_baudrates)/sizeof(supported_baudrates[0]))
+
+/* Variable to keep track of whether incoming characters are to be echoed
+ * back or not.
+ */
+static int8_t do_echo;
+
+/* Whether received bytes skip the escape sequence parser and go straight
+ * into the input buffer (see serial_set_raw_input()) */
+static volatile int8_t raw_input;
+
+/* Whether writing to a full output buffer waits for room (see
+ * serial_set_blocking())
+ */
+static int8_t tx_blocking = 1;
+
+/* Telemetry mode (see serial_set_telemetry()). Text output is thrown away
+ * while it is on so frames are never mixed up with it.
+ */
+static int8_t telemetry_mode = SERIAL_TELEMETRY;
+
+/* The frame being written (see serial_frame_begin()). Its bytes are placed
+ * after out_head but out_head is only moved past them once the frame is
+ * finished, so the UART never sends a code byte before it is filled in.
+ * frame_head is where the next byte goes and frame_code is where the
+ * current COBS code byte goes once the length of its run is known.
+ */
+static OutIndex frame_head;
+static OutIndex frame_code;
+static uint8_t frame_run;
+static uint8_t frame_crc;
+
+/* Escape sequence parser. Each received byte is put into a class and the
+ * (state, class) pair looks up the next state and the action to take in
+ * parser_table. Handles ESC [ <params> <final> (CSI) and ESC O <final> (SS3)
+ * sequences as sent by common terminals.
+ */
+#define ESCAPE_CHAR 27
+
+typedef enum {
+	PARSE_GROUND,
+	PARSE_ESCAPE,		/* Received ESC */
+	PARSE_CSI,			/* Received ESC [ and maybe a parameter */
+	PARSE_CSI_IGNORE,	/* Received ESC [ <param> ; - further params ignored */
+	PARSE_SS3,			/* Received ESC O */
+	PARSE_NUM_STATES
+} ParseState;
+
+typedef enum {
+	CLASS_OTHER,		/* Printable character with no special meaning */
+	CLASS_CONTROL,		/* Other control character */
+	CLASS_ESCAPE,
+	CLASS_ENTER,		/* \r or \n */
+	CLASS_BACKSPACE,	/* BS or DEL */
+	CLASS_DIGIT,
+	CLASS_SEMICOLON,
+	CLASS_LBRACKET,		/* [ */
+	CLASS_SS3,			/* O */
+	CLASS_FINAL,		/* Any other byte that can end a sequence (@ to ~) */
+	PARSE_NUM_CLASSES
+} ParseClass;
+
+typedef enum {
+	ACT_NONE,			/* Swallow the byte */
+	ACT_EMIT,			/* Emit the byte itself as a key */
+	ACT_ENTER,
+	ACT_BACKSPACE,
+	ACT_PARAM_CLEAR,
+	ACT_PARAM_DIGIT,
+	ACT_CSI_FINAL,		/* Look up the finished CSI sequence */
+	ACT_SS3_FINAL		/* Look up the finished SS3 sequence */
+} ParseAction;
+
+/* Entries pack the next state in the high nibble and the action in the
+ * low nibble */
+#define PARSE(state, action) (((state) << 4) | (action))
+
+static const uint8_t parser_table[PARSE_NUM_STATES][PARSE_NUM_CLASSES] PROGMEM = {
+	[PARSE_GROUND] = {
+		[CLASS_OTHER]		= PARSE(PARSE_GROUND, ACT_EMIT),
+		[CLASS_CONTROL]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_ESCAPE]		= PARSE(PARSE_ESCAPE, ACT_NONE),
+		[CLASS_ENTER]		= PARSE(PARSE_GROUND, ACT_ENTER),
+		[CLASS_BACKSPACE]	= PARSE(PARSE_GROUND, ACT_BACKSPACE),
+		[CLASS_DIGIT]		= PARSE(PARSE_GROUND, ACT_EMIT),
+		[CLASS_SEMICOLON]	= PARSE(PARSE_GROUND, ACT_EMIT),
+		[CLASS_LBRACKET]	= PARSE(PARSE_GROUND, ACT_EMIT),
+		[CLASS_SS3]			= PARSE(PARSE_GROUND, ACT_EMIT),
+		[CLASS_FINAL]		= PARSE(PARSE_GROUND, ACT_EMIT)
+	},
+	[PARSE_ESCAPE] = {
+		/* Not a sequence we know - drop the ESC and keep the byte */
+		[CLASS_OTHER]		= PARSE(PARSE_GROUND, ACT_EMIT),
+		[CLASS_CONTROL]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_ESCAPE]		= PARSE(PARSE_ESCAPE, ACT_NONE),
+		[CLASS_ENTER]		= PARSE(PARSE_GROUND, ACT_ENTER),
+		[CLASS_BACKSPACE]	= PARSE(PARSE_GROUND, ACT_BACKSPACE),
+		[CLASS_DIGIT]		= PARSE(PARSE_GROUND, ACT_EMIT),
+		[CLASS_SEMICOLON]	= PARSE(PARSE_GROUND, ACT_EMIT),
+		[CLASS_LBRACKET]	= PARSE(PARSE_CSI, ACT_PARAM_CLEAR),
+		[CLASS_SS3]			= PARSE(PARSE_SS3, ACT_NONE),
+		[CLASS_FINAL]		= PARSE(PARSE_GROUND, ACT_EMIT)
+	},
+	[PARSE_CSI] = {
+		[CLASS_OTHER]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_CONTROL]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_ESCAPE]		= PARSE(PARSE_ESCAPE, ACT_NONE),
+		[CLASS_ENTER]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_BACKSPACE]	= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_DIGIT]		= PARSE(PARSE_CSI, ACT_PARAM_DIGIT),
+		[CLASS_SEMICOLON]	= PARSE(PARSE_CSI_IGNORE, ACT_NONE),
+		[CLASS_LBRACKET]	= PARSE(PARSE_GROUND, ACT_CSI_FINAL),
+		[CLASS_SS3]			= PARSE(PARSE_GROUND, ACT_CSI_FINAL),
+		[CLASS_FINAL]		= PARSE(PARSE_GROUND, ACT_CSI_FINAL)
+	},
+	[PARSE_CSI_IGNORE] = {
+		[CLASS_OTHER]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_CONTROL]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_ESCAPE]		= PARSE(PARSE_ESCAPE, ACT_NONE),
+		[CLASS_ENTER]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_BACKSPACE]	= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_DIGIT]		= PARSE(PARSE_CSI_IGNORE, ACT_NONE),
+		[CLASS_SEMICOLON]	= PARSE(PARSE_CSI_IGNORE, ACT_NONE),
+		[CLASS_LBRACKET]	= PARSE(PARSE_GROUND, ACT_CSI_FINAL),
+		[CLASS_SS3]			= PARSE(PARSE_GROUND, ACT_CSI_FINAL),
+		[CLASS_FINAL]		= PARSE(PARSE_GROUND, ACT_CSI_FINAL)
+	},
+	[PARSE_SS3] = {
+		[CLASS_OTHER]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_CONTROL]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_ESCAPE]		= PARSE(PARSE_ESCAPE, ACT_NONE),
+		[CLASS_ENTER]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_BACKSPACE]	= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_DIGIT]		= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_SEMICOLON]	= PARSE(PARSE_GROUND, ACT_NONE),
+		[CLASS_LBRACKET]	= PARSE(PARSE_GROUND, ACT_SS3_FINAL),
+		[CLASS_SS3]			= PARSE(PARSE_GROUND, ACT_SS3_FINAL),
+		[CLASS_FINAL]		= PARSE(PARSE_GROUND, ACT_SS3_FINAL)
+	}
+};
+
+/* Keys for sequences identified by their final byte, e.g. ESC [ A. The same
+ * table is used for ESC O sequences (application cursor keys and F1-F4).
+ * Each entry is a final byte followed by the key it decodes to.
+ */
+static const uint8_t final_byte_keys[][2] PROGMEM = {
+	{ 'A', KEY_UP },
+	{ 'B', KEY_DOWN },
+	{ 'C', KEY_RIGHT },
+	{ 'D', KEY_LEFT },
+	{ 'H', KEY_HOME },
+	{ 'F', KEY_END },
+	{ 'P', KEY_F1 },
+	{ 'Q', KEY_F2 },
+	{ 'R', KEY_F3 },
+	{ 'S', KEY_F4 }
+};
+
+/* Keys for ESC [ <param> ~ sequences. Each entry is the parameter followed
+ * by the key it decodes to.
+ */
+static const uint8_t tilde_keys[][2] PROGMEM = {
+	{ 1, KEY_HOME },
+	{ 2, KEY_INSERT },
+	{ 3, KEY_DELETE },
+	{ 4, KEY_END },
+	{ 5, KEY_PAGE_UP },
+	{ 6, KEY_PAGE_DOWN },
+	{ 7, KEY_HOME },
+	{ 8, KEY_END },
+	{ 11, KEY_F1 },
+	{ 12, KEY_F2 },
+	{ 13, KEY_F3 },
+	{ 14, KEY_F4 },
+	{ 15, KEY_F5 },
+	{ 17, KEY_F6 },
+	{ 18, KEY_F7 },
+	{ 19, KEY_F8 },
+	{ 20, KEY_F9 },
+	{ 21, KEY_F10 },
+	{ 23, KEY_F11 },
+	{ 24, KEY_F12 }
+};
+
+static uint8_t parse_state;
+static uint8_t parse_param;
+
+/* Auto-repeat of held keys (see serial_key_pushed()). A key counts as held
+ * while the terminal keeps resending it at least this often (ms). Only keys
+ * the hold filter accepts are treated this way (see serial_set_hold_filter()).
+ */
+#define SERIAL_HOLD_TIMEOUT 80
+/* The same timeout in fine time units (8us) */
+#define SERIAL_HOLD_FINE (SERIAL_HOLD_TIMEOUT * 125U)
+static SerialHoldFilter hold_filter;
+static int16_t key_held = NO_KEY_HELD;
+/* When the held key was last seen (ms) and received (fine time) */
+static uint32_t key_held_time;
+static uint32_t key_held_stamp;
+static RepeatState key_repeat;
+/* Set if the last byte parsed was a CR, so that the LF of a CRLF is not a
+ * second Enter. */
+static uint8_t after_cr;
+/* Stamp of the key last returned by serial_key_pushed() */
+static uint32_t last_key_stamp;
+
+/* Function prototypes 
+ */
+void init_serial_stdio(long baudrate, int8_t echo);
+static int uart_put_char(char, FILE*);
+static int uart_get_char(FILE*);
+static void parse_byte(uint8_t c);
+static uint8_t lookup_key(const uint8_t (*table)[2], uint8_t size, uint8_t code);
+static void queue_key(uint8_t key);
+static void queue_byte(uint8_t byte);
+static OutIndex out_count(void);
+static InIndex input_count(void);
+static uint32_t ubrr_baudrate(uint16_t ubrr, uint8_t u2x);
+
+/* Setup a stream that uses the uart get and put functions. We will
+ * make standard input and output use this stream below.
+ */
+static FILE myStream = FDEV_SETUP_STREAM(uart_put_char, uart_get_char,
+		_FDEV_SETUP_RW);
+
+void init_serial_stdio(long baudrate, int8_t echo) {
+	uint16_t ubrr;
+	uint16_t ubrr2x;
+	uint32_t error;
+	uint32_t error2x;
+	/*
+	 * Initialise our buffers
+	*/
+	out_head = 0;
+	out_tail = 0;
+	input_head = 0;
+	input_tail = 0;
+	serial_clear_stats();
+	parse_state = PARSE_GROUND;
+	
+	/*
+	 * Record whether we're going to echo characters or not
+	*/
+	do_echo = echo;
+	
+	/* Configure the serial port baud rate */
+	/* (This differs from the datasheet formula so that we get 
+	 * rounding to the nearest integer while using integer division
+	 * (which truncates)).
+	 * The setting is worked out for both normal (16 samples per bit)
+	 * and double speed (U2X0, 8 samples per bit) mode and whichever
+	 * gives the rate closest to the one asked for is used. Normal mode
+	 * wins a tie as it is more tolerant of noise. At 8MHz this brings
+	 * 57600 down to 2.1% error (from 3.5%) while 250000 is exact in
+	 * normal mode. 115200 is still 3.5% out so it isn't supported.
+	*/
+	ubrr = ((SYSCLK / (8 * baudrate)) + 1)/2;
+	ubrr2x = ((SYSCLK / (4 * baudrate)) + 1)/2;
+	ubrr = (ubrr > 0) ? ubrr - 1 : 0;
+	ubrr2x = (ubrr2x > 0) ? ubrr2x - 1 : 0;
+	error = labs((long)ubrr_baudrate(ubrr, 0) - baudrate);
+	error2x = labs((long)ubrr_baudrate(ubrr2x, 1) - baudrate);
+	requested_baudrate = baudrate;
+	if(error2x < error) {
+		baud_ubrr = ubrr2x;
+		baud_u2x = 1;
+		UCSR0A |= (1<<U2X0);
+	} else {
+		baud_ubrr = ubrr;
+		baud_u2x = 0;
+		UCSR0A &= ~(1<<U2X0);
+	}
+	UBRR0 = baud_ubrr;
+	
+	/*
+	 * Enable transmission and receiving via UART. We don't enable
+	 * the UDR empty interrupt here (we wait until we've got a
+	 * character to transmit).
+	 * NOTE: Interrupts must be enabled globally for this
+	 * library to work, but we do not do this here.
+	*/
+	UCSR0B = (1<<RXEN0)|(1<<TXEN0);
+	
+	/*
+	 * Enable receive complete interrupt 
+	*/
+	UCSR0B  |= (1 <<RXCIE0);
+
+	/* Set up our stream so the put and get functions below are used 
+	 * to write/read characters via the serial port when we use
+	 * stdio functions
+	*/
+	stdout = &myStream;
+	stdin = &myStream;
+}
+
+void serial_put_char(char c) {
+	uart_put_char(c, 0);
+}
+
+void serial_put_string_P(const char* string) {
+	char c;
+	while((c = pgm_read_byte(string++)) != 0) {
+		uart_put_char(c, 0);
+	}
+}
+
+void serial_set_telemetry(int8_t on) {
+	telemetry_mode = on;
+}
+
+int8_t serial_telemetry(void) {
+	return telemetry_mode;
+}
+
+uint8_t serial_frame_begin(uint8_t length) {
+	/* Worst case the frame needs the payload and CRC, a code byte for
+	 * every 254 of them, the first code byte and the delimiter. */
+	uint16_t needed = length + 1 + (length + 1)/254 + 2;
+	if(serial_tx_free() < needed) {
+		uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+		cli();
+		stats.tx_stalls++;
+		if(interrupts_enabled) {
+			sei();
+		}
+		return 0;
+	}
+	/* Only the main program moves out_head so it can be read directly */
+	frame_code = out_head;
+	frame_head = out_head + 1;
+	frame_run = 1;
+	frame_crc = 0;
+	return 1;
+}
+
+void serial_frame_byte(uint8_t byte) {
+	frame_crc = _crc8_ccitt_update(frame_crc, byte);
+	if(byte != 0) {
+		out_buffer[frame_head++ & (OUTPUT_BUFFER_SIZE - 1)] = byte;
+		frame_run++;
+	}
+	if(byte == 0 || frame_run == 0xFF) {
+		/* End of a run - fill in its code byte and start the next */
+		out_buffer[frame_code & (OUTPUT_BUFFER_SIZE - 1)] = frame_run;
+		frame_code = frame_head++;
+		frame_run = 1;
+	}
+}
+
+void serial_frame_end(void) {
+	/* The CRC goes through the encoder like any other byte */
+	serial_frame_byte(frame_crc);
+	out_buffer[frame_code & (OUTPUT_BUFFER_SIZE - 1)] = frame_run;
+	out_buffer[frame_head++ & (OUTPUT_BUFFER_SIZE - 1)] = 0;
+
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	out_head = frame_head;
+	OutIndex waiting = out_head - out_tail;
+	if(waiting > stats.tx_peak) {
+		stats.tx_peak = waiting;
+	}
+	UCSR0B |= (1 << UDRIE0);
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+void serial_set_blocking(int8_t blocking) {
+	tx_blocking = blocking;
+}
+
+uint16_t serial_tx_free(void) {
+	return OUTPUT_BUFFER_SIZE - out_count();
+}
+
+uint8_t serial_try_write(const char* data, uint8_t length) {
+	if(telemetry_mode) {
+		/* Thrown away like any other text */
+		return length;
+	}
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	OutIndex waiting = out_head - out_tail;
+	OutIndex room = OUTPUT_BUFFER_SIZE - waiting;
+	uint8_t count = (room < length) ? room : length;
+	if(count < length) {
+		stats.tx_stalls++;
+	}
+	for(uint8_t i = 0; i < count; i++) {
+		out_buffer[out_head & (OUTPUT_BUFFER_SIZE - 1)] = data[i];
+		out_head++;
+	}
+	if(count) {
+		waiting += count;
+		if(waiting > stats.tx_peak) {
+			stats.tx_peak = waiting;
+		}
+		UCSR0B |= (1 << UDRIE0);
+	}
+	if(interrupts_enabled) {
+		sei();
+	}
+	return count;
+}
+
+uint8_t serial_write_all(const char* data, uint8_t length) {
+	if(telemetry_mode) {
+		return 1;
+	}
+	if(bit_is_set(SREG, SREG_I) && tx_blocking) {
+		while(serial_tx_free() < length) {
+			/* The ISR makes room */
+		}
+	}
+	/* Only this side adds to the buffer, so the room can't shrink between
+	 * the check and the write */
+	if(serial_tx_free() < length) {
+		/* Reserve or skip - none of it is sent */
+		uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+		cli();
+		stats.tx_stalls++;
+		if(interrupts_enabled) {
+			sei();
+		}
+		return 0;
+	}
+	return serial_try_write(data, length) == length;
+}
+
+int8_t serial_input_available(void) {
+	return (input_count() != 0);
+}
+
+void clear_serial_input_buffer(void) {
+	/* Just move the tail up to the head so the buffer looks empty. The
+	 * parser state is left alone so the rest of a partly received sequence
+	 * is still swallowed. */
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	input_tail = input_head;
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+void serial_set_raw_input(int8_t on) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	raw_input = on;
+	parse_state = PARSE_GROUND;
+	after_cr = 0;
+	input_tail = input_head;
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+int16_t serial_read_byte(void) {
+	if(input_count() == 0) {
+		return -1;
+	}
+	return uart_get_char(0);
+}
+
+void serial_get_stats(SerialStats* copy) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	copy->rx_dropped = stats.rx_dropped;
+	copy->tx_stalls = stats.tx_stalls;
+	copy->rx_peak = stats.rx_peak;
+	copy->tx_peak = stats.tx_peak;
+	copy->tx_bytes = stats.tx_bytes;
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+void serial_clear_stats(void) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	stats.rx_dropped = 0;
+	stats.tx_stalls = 0;
+	stats.rx_peak = 0;
+	stats.tx_peak = 0;
+	stats.tx_bytes = 0;
+	stats_since = get_current_time();
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+long serial_saved_baudrate(void) {
+	uint32_t baudrate;
+	if(!journal_read(JOURNAL_KEY_BAUDRATE, &baudrate, sizeof(baudrate))) {
+		return SERIAL_BAUDRATE;
+	}
+	return baudrate;
+}
+
+long serial_next_baudrate(void) {
+	/* Find the saved rate in the list and move on to the next one. A rate
+	 * that isn't in the list (e.g. a build time rate) moves to the first.
+	 */
+	uint32_t current = serial_saved_baudrate();
+	uint8_t i;
+	for(i = 0; i < NUM_BAUDRATES; i++) {
+		if(pgm_read_dword(&supported_baudrates[i]) == current) {
+			i++;
+			break;
+		}
+	}
+	if(i >= NUM_BAUDRATES) {
+		i = 0;
+	}
+	uint32_t next = pgm_read_dword(&supported_baudrates[i]);
+	journal_write(JOURNAL_KEY_BAUDRATE, &next, sizeof(next));
+	return next;
+}
+
+void serial_report(void) {
+	SerialStats copy;
+	uint32_t actual = ubrr_baudrate(baud_ubrr, baud_u2x);
+	/* Error in tenths of a percent */
+	int16_t error = ((int32_t)actual - requested_baudrate) * 1000
+			/ requested_baudrate;
+	uint32_t elapsed = get_current_time() - stats_since;
+
+	serial_get_stats(&copy);
+
+	clear_report_area();
+	term_put_string_P(PSTR("Serial: asked "));
+	term_put_unsigned(requested_baudrate, 0);
+	term_put_string_P(PSTR(" baud, UBRR0="));
+	term_put_unsigned(baud_ubrr, 0);
+	term_put_string_P(PSTR(" U2X0="));
+	term_put_unsigned(baud_u2x, 0);
+	term_put_string_P(PSTR(" gives "));
+	term_put_unsigned(actual, 0);
+	term_put_string_P(PSTR(" baud ("));
+	serial_put_char((error < 0) ? '-' : '+');
+	term_put_unsigned(abs(error) / 10, 0);
+	serial_put_char('.');
+	term_put_unsigned(abs(error) % 10, 0);
+	term_put_string_P(PSTR("% error)"));
+	if(abs(error) > BAUD_ERROR_LIMIT) {
+		term_put_string_P(PSTR(" UNSUPPORTED"));
+	}
+	move_cursor(1, REPORT_FIRST_ROW + 1);
+	/* Each byte is 10 bits on the line (start, 8 data, stop) */
+	term_put_string_P(PSTR("Sent "));
+	term_put_unsigned(copy.tx_bytes, 0);
+	term_put_string_P(PSTR(" bytes in "));
+	term_put_unsigned(elapsed, 0);
+	term_put_string_P(PSTR(" ms = "));
+	/* 64 bit so that bytes * 1000 doesn't overflow after ~4MB */
+	term_put_unsigned((elapsed > 0) ?
+			(uint64_t)copy.tx_bytes * 1000 / elapsed : 0, 0);
+	term_put_string_P(PSTR(" B/s (line limit "));
+	term_put_unsigned(actual / 10, 0);
+	term_put_string_P(PSTR(" B/s)"));
+	move_cursor(1, REPORT_FIRST_ROW + 2);
+	term_put_string_P(PSTR("RX dropped "));
+	term_put_unsigned(copy.rx_dropped, 0);
+	term_put_string_P(PSTR(" peak "));
+	term_put_unsigned(copy.rx_peak, 0);
+	serial_put_char('/');
+	term_put_unsigned(INPUT_BUFFER_SIZE, 0);
+	term_put_string_P(PSTR(", TX stalls "));
+	term_put_unsigned(copy.tx_stalls, 0);
+	term_put_string_P(PSTR(" peak "));
+	term_put_unsigned(copy.tx_peak, 0);
+	serial_put_char('/');
+	term_put_unsigned(OUTPUT_BUFFER_SIZE, 0);
+}
+
+void serial_set_hold_filter(SerialHoldFilter is_held_key) {
+	hold_filter = is_held_key;
+	key_held = NO_KEY_HELD;
+}
+
+uint8_t serial_key_pushed(void) {
+	uint32_t now = get_current_time();
+	int16_t key = NO_KEY_HELD;
+
+	if(input_count() != 0) {
+		key = uart_get_char(0);
+		if(!hold_filter || !hold_filter(key)) {
+			key_held = NO_KEY_HELD;
+			return key;
+		}
+		/* Times between copies of the key are taken from when they were
+		 * received, so keys that waited in the buffer aren't mistaken for
+		 * a held key. */
+		if(key == key_held &&
+				last_key_stamp - key_held_stamp < SERIAL_HOLD_FINE) {
+			/* The terminal is auto-repeating a held key. Swallow it - the
+			 * repeat engine decides when the key repeats. */
+			key_held_time = now;
+			key_held_stamp = last_key_stamp;
+			return KEY_NONE;
+		}
+		key_held = key;
+		key_held_time = now;
+		key_held_stamp = last_key_stamp;
+		repeat_start(&key_repeat, key, now);
+		return key;
+	}
+
+	/* No new key - repeat the held one if it is due */
+	if(key_held != NO_KEY_HELD && now - key_held_time >= SERIAL_HOLD_TIMEOUT) {
+		key_held = NO_KEY_HELD;
+	}
+	key = repeat_due(&key_repeat, key_held, now);
+	if(key == NO_KEY_HELD) {
+		return KEY_NONE;
+	}
+	last_key_stamp = get_fine_time32();
+	return key;
+}
+
+uint32_t serial_key_stamp(void) {
+	return last_key_stamp;
+}
+
+static int uart_put_char(char c, FILE* stream) {
+	uint8_t interrupts_enabled;
+	OutIndex waiting;
+	
+	/* Add the character to the buffer for transmission (if there 
+	 * is space to do so). If not we wait until the buffer has space.
+	 * If the character is \n, we output \r (carriage return)
+	 * also.
+	*/
+	if(telemetry_mode) {
+		/* Text would corrupt the telemetry frames */
+		return 0;
+	}
+	if(c == '\n') {
+		uart_put_char('\r', stream);
+	}
+	
+	/* If the buffer is full and interrupts are disabled (or blocking
+	 * has been turned off) then we abort - we don't output the character
+	 * since the buffer will never be emptied if interrupts are disabled.
+	 * If the buffer is full and interrupts are enabled then we loop
+	 * until the buffer has enough space. The tail will get moved by the
+	 * ISR which extracts bytes from the buffer. Either way it is counted
+	 * as a stall.
+	*/
+	interrupts_enabled = bit_is_set(SREG, SREG_I);
+	if(out_count() >= OUTPUT_BUFFER_SIZE) {
+		cli();
+		stats.tx_stalls++;
+		if(!interrupts_enabled || !tx_blocking) {
+			if(interrupts_enabled) {
+				sei();
+			}
+			return 1;
+		}
+		sei();
+		while(out_count() >= OUTPUT_BUFFER_SIZE) {
+			/* do nothing */
+		}
+	}
+	
+	/* Add the character to the buffer for transmission and advance
+	 * the head. The index is masked so it wraps around to the
+	 * beginning of the buffer.
+	 * NOTE: we disable interrupts before modifying the buffer. This
+	 * prevents the ISR from modifying the buffer at the same time.
+	 * We reenable them if they were enabled when we entered the
+	 * function.
+	*/	
+	cli();
+	out_buffer[out_head & (OUTPUT_BUFFER_SIZE - 1)] = c;
+	out_head++;
+	waiting = out_head - out_tail;
+	if(waiting > stats.tx_peak) {
+		stats.tx_peak = waiting;
+	}
+	/* Reenable interrupts (UDR Empty interrupt may have been
+	 * disabled) - we ensure it is now enabled so that it will
+	 * fire and deal with the next character in the buffer. */
+	UCSR0B |= (1 << UDRIE0);
+	if(interrupts_enabled) {
+		sei();
+	}
+	return 0;
+}
+
+static int uart_get_char(FILE* stream) {
+	/* Wait until we've received a character */
+	while(input_count() == 0) {
+		/* do nothing */
+	}
+	
+	/*
+	 * Turn interrupts off and remove a character from the input
+	 * buffer. We reenable interrupts if they were on.
+	 * The pending character is the one at the tail.
+	 */
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	uint8_t c = input_buffer[input_tail & (INPUT_BUFFER_SIZE - 1)];
+	last_key_stamp = input_stamps[input_tail & (INPUT_BUFFER_SIZE - 1)];
+	input_tail++;
+	if(interrupts_enabled) {
+		sei();
+	}	
+	return c;
+}
+
+/*
+ * Define the interrupt handler for UART Data Register Empty (i.e. 
+ * another character can be taken from our buffer and written out)
+ */
+ISR(USART0_UDRE_vect) 
+{
+	/* Check if we have data in our buffer */
+	if(out_head != out_tail) {
+		/* Yes we do - remove the pending byte at the tail and
+		 * output it via the UART.
+		 */
+		UDR0 = out_buffer[out_tail & (OUTPUT_BUFFER_SIZE - 1)];
+		out_tail++;
+		stats.tx_bytes++;
+		idle_woken_by(IDLE_WAKE_SERIAL_TX);
+	} else {
+		/* No data in the buffer. We disable the UART Data
+		 * Register Empty interrupt because otherwise it 
+		 * will trigger again immediately this ISR exits. 
+		 * The interrupt is reenabled when a character is
+		 * placed in the buffer.
+		 */
+		UCSR0B &= ~(1<<UDRIE0);
+	}
+}
+
+/*
+ * Define the interrupt handler for UART Receive Complete (i.e. 
+ * we can read a character. The character is run through the escape
+ * sequence parser which places any decoded keys in the input buffer.
+ */
+
+ISR(USART0_RX_vect) 
+{
+	/* Read the character. A byte the hardware had to drop because we
+	 * were too slow to read the last one is counted as dropped. */
+	char c;
+	if(UCSR0A & (1<<DOR0)) {
+		stats.rx_dropped++;
+	}
+	c = UDR0;
+	idle_woken_by(IDLE_WAKE_SERIAL_RX);
+		
+	if(do_echo && (OutIndex)(out_head - out_tail) < OUTPUT_BUFFER_SIZE) {
+		/* If echoing is enabled and there is output buffer
+		 * space, echo the received character back to the UART.
+		 * (If there is no output buffer space, characters
+		 * will be lost.)
+		 */
+		uart_put_char(c, 0);
+	}
+	
+	if(raw_input) {
+		queue_byte(c);
+	} else {
+		parse_byte(c);
+	}
+}
+
+/*
+ * Run one received byte through the escape sequence parser.
+ */
+static void parse_byte(uint8_t c) {
+	uint8_t class;
+	uint8_t lf_after_cr = (c == '\n' && after_cr);
+
+	after_cr = (c == '\r');
+	if(c == ESCAPE_CHAR) {
+		class = CLASS_ESCAPE;
+	} else if(c == '\r' || c == '\n') {
+		class = CLASS_ENTER;
+	} else if(c == '\b' || c == 0x7F) {
+		class = CLASS_BACKSPACE;
+	} else if(c < ' ' || c > '~') {
+		class = CLASS_CONTROL;
+	} else if(c >= '0' && c <= '9') {
+		class = CLASS_DIGIT;
+	} else if(c == ';') {
+		class = CLASS_SEMICOLON;
+	} else if(c == '[') {
+		class = CLASS_LBRACKET;
+	} else if(c == 'O') {
+		class = CLASS_SS3;
+	} else if(c >= '@') {
+		class = CLASS_FINAL;
+	} else {
+		class = CLASS_OTHER;
+	}
+
+	uint8_t entry = pgm_read_byte(&parser_table[parse_state][class]);
+	parse_state = entry >> 4;
+
+	switch(entry & 0x0F) {
+		case ACT_EMIT:
+			queue_key(c);
+			break;
+		case ACT_ENTER:
+			/* CR, LF and CRLF are all one Enter */
+			if(!lf_after_cr) {
+				queue_key(KEY_ENTER);
+			}
+			break;
+		case ACT_BACKSPACE:
+			queue_key(KEY_BACKSPACE);
+			break;
+		case ACT_PARAM_CLEAR:
+			parse_param = 0;
+			break;
+		case ACT_PARAM_DIGIT:
+			/* Parameters we care about are never more than 2 digits */
+			if(parse_param < 100) {
+				parse_param = parse_param*10 + (c - '0');
+			}
+			break;
+		case ACT_CSI_FINAL:
+			if(c == '~') {
+				queue_key(lookup_key(tilde_keys,
+						sizeof(tilde_keys)/sizeof(tilde_keys[0]), parse_param));
+			} else {
+				queue_key(lookup_key(final_byte_keys,
+						sizeof(final_byte_keys)/sizeof(final_byte_keys[0]), c));
+			}
+			break;
+		case ACT_SS3_FINAL:
+			queue_key(lookup_key(final_byte_keys,
+					sizeof(final_byte_keys)/sizeof(final_byte_keys[0]), c));
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * Return the key paired with code in the given PROGMEM table or KEY_NONE.
+ */
+static uint8_t lookup_key(const uint8_t (*table)[2], uint8_t size, uint8_t code) {
+	for(uint8_t i = 0; i < size; i++) {
+		if(pgm_read_byte(&table[i][0]) == code) {
+			return pgm_read_byte(&table[i][1]);
+		}
+	}
+	return KEY_NONE;
+}
+
+/*
+ * Add a decoded key to the input buffer. Called from the receive interrupt
+ * handler.
+ */
+static void queue_key(uint8_t key) {
+	if(key == KEY_NONE) {
+		/* Unknown sequence */
+		return;
+	}
+	queue_byte(key);
+}
+
+/*
+ * Add a byte to the input buffer. Called from the receive interrupt handler.
+ */
+static void queue_byte(uint8_t byte) {
+	/* 
+	 * Check if we have space in our buffer. If not, count the key as
+	 * dropped and throw it away (see serial_get_stats()).
+	 */
+	InIndex waiting = input_head - input_tail;
+	if(waiting >= INPUT_BUFFER_SIZE) {
+		stats.rx_dropped++;
+	} else {
+		/* 
+		 * There is room in the input buffer 
+		 */
+		input_stamps[input_head & (INPUT_BUFFER_SIZE - 1)] = get_fine_time32();
+		input_buffer[input_head & (INPUT_BUFFER_SIZE - 1)] = byte;
+		input_head++;
+		if(++waiting > stats.rx_peak) {
+			stats.rx_peak = waiting;
+		}
+	}
+}
+
+/*
+ * Return the number of characters waiting in the output buffer. The
+ * indices are read with interrupts off as they may be 16 bits wide.
+ */
+static OutIndex out_count(void) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	OutIndex count = out_head - out_tail;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return count;
+}
+
+/*
+ * Return the baud rate the given UBRR0 and U2X0 settings produce.
+ */
+static uint32_t ubrr_baudrate(uint16_t ubrr, uint8_t u2x) {
+	return SYSCLK / ((uint32_t)(u2x ? 8 : 16) * (ubrr + 1));
+}
+
+/*
+ * Return the number of keys waiting in the input buffer.
+ */
+static InIndex input_count(void) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	InIndex count = input_head - input_tail;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return count;
+}
@@ -1,39 +1,223 @@
-/*
- * serialio.h
- *
- * Author: Peter Sutton
- * 
- * Module to allow standard input/output routines to be used via 
- * serial port 0. The init_serial_stdio() method must be called before
- * any standard IO methods (e.g. printf). We use interrupt-based serial
- * IO and a circular buffer to store output messages. (This allows us 
- * to print many characters at once to the buffer and have them 
- * output by the UART as speed permits.) Interrupts must be enabled 
- * globally for this module to work (after init_serial_stdio() is called).
- *
- */
-
-#ifndef SERIALIO_H_
-#define SERIALIO_H_
-
-#include <stdint.h>
-
-/* Initialise serial IO using the UART. baudrate specifies the desired
- * baudrate (e.g. 19200) and echo determines whether incoming characters
- * are echoed back to the UART output as they are received (zero means no
- * echo, non-zero means echo)
- */
-void init_serial_stdio(long baudrate, int8_t echo);
-
-/* Test if input is available from the serial port. Return 0 if not,
- * non-zero otherwise. If there is input available then it can be read
- * with a suitable standard IO library function, e.g. fgetc().
- */
-int8_t serial_input_available(void);
-
-/* Discard any input waiting to be read from the serial port. (Characters may
- * have been typed when we didn't want them - clear them.
- */
-void clear_serial_input_buffer(void);
-
+/*
+ * serialio.h
+ *
+ * Author: Peter Sutton
+ * 
+ * Module to allow standard input/output routines to be used via 
+ * serial port 0. The init_serial_stdio() method must be called before
+ * any standard IO methods (e.g. printf). We use interrupt-based serial
+ * IO and a circular buffer to store output messages. (This allows us 
+ * to print many characters at once to the buffer and have them 
+ * output by the UART as speed permits.) Interrupts must be enabled 
+ * globally for this module to work (after init_serial_stdio() is called).
+ *
+ */
+
+#ifndef SERIALIO_H_
+#define SERIALIO_H_
+
+#include <stdint.h>
+
+/* Key events placed in the input buffer. Escape sequences sent by the
+ * terminal are decoded in the receive interrupt handler - printable
+ * characters are passed through unchanged, Enter and Backspace are
+ * normalised and other special keys get codes above the ASCII range.
+ */
+#define KEY_NONE 0
+#define KEY_BACKSPACE '\b'
+#define KEY_ENTER '\n'
+#define KEY_UP 0x80
+#define KEY_DOWN 0x81
+#define KEY_RIGHT 0x82
+#define KEY_LEFT 0x83
+#define KEY_HOME 0x84
+#define KEY_END 0x85
+#define KEY_INSERT 0x86
+#define KEY_DELETE 0x87
+#define KEY_PAGE_UP 0x88
+#define KEY_PAGE_DOWN 0x89
+#define KEY_F1 0x90
+#define KEY_F2 0x91
+#define KEY_F3 0x92
+#define KEY_F4 0x93
+#define KEY_F5 0x94
+#define KEY_F6 0x95
+#define KEY_F7 0x96
+#define KEY_F8 0x97
+#define KEY_F9 0x98
+#define KEY_F10 0x99
+#define KEY_F11 0x9A
+#define KEY_F12 0x9B
+
+/* Baud rate used when none has been saved in EEPROM (see
+ * serial_saved_baudrate()). Can be overridden from the build settings.
+ */
+#ifndef SERIAL_BAUDRATE
+	#define SERIAL_BAUDRATE 19200L
+#endif
+
+/* Non-zero to start up in telemetry mode (see serial_set_telemetry()) */
+#ifndef SERIAL_TELEMETRY
+	#define SERIAL_TELEMETRY 0
+#endif
+
+/* Sizes of the output (characters) and input (key events) ring buffers.
+ * Both must be powers of two and may be larger than 255. They can be
+ * overridden from the build settings. Each input entry takes 5 bytes of
+ * RAM (the key and its time stamp).
+ */
+#ifndef OUTPUT_BUFFER_SIZE
+	#define OUTPUT_BUFFER_SIZE 256
+#endif
+#ifndef INPUT_BUFFER_SIZE
+	#define INPUT_BUFFER_SIZE 64
+#endif
+
+/* Statistics kept on the serial buffers since they were last cleared.
+ * rx_dropped - keys thrown away because the input buffer was full plus
+ *              bytes lost by the UART because they weren't read in time
+ * tx_stalls  - writes that found the output buffer full (the writer
+ *              waited, or discarded what didn't fit if it can't block)
+ * rx_peak    - largest number of keys waiting in the input buffer
+ * tx_peak    - largest number of characters waiting in the output buffer
+ * tx_bytes   - characters sent by the UART
+ */
+typedef struct {
+	uint16_t rx_dropped;
+	uint16_t tx_stalls;
+	uint16_t rx_peak;
+	uint16_t tx_peak;
+	uint32_t tx_bytes;
+} SerialStats;
+
+/* Initialise serial IO using the UART. baudrate specifies the desired
+ * baudrate (e.g. 19200) and double speed mode is used if it gets closer
+ * to it. echo determines whether incoming characters
+ * are echoed back to the UART output as they are received (zero means no
+ * echo, non-zero means echo)
+ */
+void init_serial_stdio(long baudrate, int8_t echo);
+
+/* Write a character or a string stored in program memory straight to the
+ * output buffer without going through stdio. As with printf, \n is sent
+ * as \r\n.
+ */
+void serial_put_char(char c);
+void serial_put_string_P(const char* string);
+
+/* Turn telemetry mode on (non-zero) or off. In telemetry mode all text
+ * output (stdio, serial_put_char() and the terminal functions) is thrown
+ * away and only binary frames are sent.
+ */
+void serial_set_telemetry(int8_t on);
+int8_t serial_telemetry(void);
+
+/* Binary frames. Each frame is a payload followed by its CRC-8 (polynomial
+ * 0x07, initial value 0), COBS encoded and ended with a zero byte. The
+ * encoded bytes are written straight into the output buffer.
+ * serial_frame_begin() reserves room for a payload of length bytes and
+ * returns 0 (dropping the frame) if there isn't room - it never waits. If
+ * it returns non-zero exactly length bytes must be written with
+ * serial_frame_byte() followed by serial_frame_end(). Frames must only be
+ * written from the main program, not interrupt handlers.
+ */
+uint8_t serial_frame_begin(uint8_t length);
+void serial_frame_byte(uint8_t byte);
+void serial_frame_end(void);
+
+/* Set whether writing a character to a full output buffer (with stdio or
+ * serial_put_char()) waits for room (non-zero, the default) or throws the
+ * character away (zero). Characters are always thrown away if interrupts
+ * are off.
+ */
+void serial_set_blocking(int8_t blocking);
+
+/* Return how many characters the output buffer has room for.
+ */
+uint16_t serial_tx_free(void);
+
+/* Copy as much of the length bytes of data as fits in the output buffer
+ * without waiting and return the number of bytes accepted. The bytes are
+ * sent as they are (\n is not expanded). In telemetry mode they are thrown
+ * away and length is returned.
+ */
+uint8_t serial_try_write(const char* data, uint8_t length);
+
+/* Write all length bytes of data to the output buffer or none of them, so
+ * that a sequence (e.g. an escape sequence) is never sent in part. Like
+ * serial_put_char() this waits for room if blocking (see
+ * serial_set_blocking()). Otherwise it never waits and the bytes are
+ * dropped together when they don't all fit. Returns non-zero if they were
+ * written (always in telemetry mode).
+ */
+uint8_t serial_write_all(const char* data, uint8_t length);
+
+/* Test if input is available from the serial port. Return 0 if not,
+ * non-zero otherwise. If there is input available then it can be read
+ * with a suitable standard IO library function, e.g. fgetc().
+ */
+int8_t serial_input_available(void);
+
+/* Discard any input waiting to be read from the serial port. (Characters may
+ * have been typed when we didn't want them - clear them.
+ */
+void clear_serial_input_buffer(void);
+
+/* Turn raw input on (non-zero) or off. In raw mode received bytes are put in
+ * the input buffer unchanged (for binary uploads) and must be read with
+ * serial_read_byte() rather than serial_key_pushed(). Anything waiting in
+ * the input buffer is thrown away.
+ */
+void serial_set_raw_input(int8_t on);
+
+/* Return the next byte in the input buffer or -1 if there is none. Never
+ * waits.
+ */
+int16_t serial_read_byte(void);
+
+/* Return the next key event (see KEY_ above) or KEY_NONE if there is none.
+ * Keys that the hold filter accepts (see serial_set_hold_filter()) and that
+ * the terminal resends while they are held are replaced by repeats from the
+ * shared repeat engine so they repeat at the same rate as the buttons. Every
+ * other key is returned each time it is received.
+ */
+uint8_t serial_key_pushed(void);
+
+/* Set the function that says which keys can be held (e.g. movement keys
+ * while playing). It returns non-zero for a key that can be held. 0 turns
+ * the hold handling off so typed text comes through unchanged.
+ */
+typedef uint8_t (*SerialHoldFilter)(uint8_t key);
+void serial_set_hold_filter(SerialHoldFilter is_held_key);
+
+/* Return the fine time stamp (see get_fine_time32()) of the key last returned by
+ * serial_key_pushed(), i.e. when its last byte was received.
+ */
+uint32_t serial_key_stamp(void);
+
+/* Copy the current buffer statistics (see SerialStats) into stats.
+ */
+void serial_get_stats(SerialStats* stats);
+
+/* Reset all buffer statistics to zero.
+ */
+void serial_clear_stats(void);
+
+/* Return the baud rate saved in EEPROM or SERIAL_BAUDRATE if none has been
+ * saved.
+ */
+long serial_saved_baudrate(void);
+
+/* Save the next of the supported baud rates (19200, 38400, 57600 and
+ * 250000) in EEPROM and return it. It is used from the next reset.
+ */
+long serial_next_baudrate(void);
+
+/* Print the baud rate setting, its error, the measured output throughput
+ * since the statistics were cleared and the buffer statistics on the
+ * terminal. It takes the first 3 rows of the report area (see
+ * clear_report_area()).
+ */
+void serial_report(void);
+
 #endif /* SERIALIO_H_ */
\ No newline at end of file
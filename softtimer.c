@@ -0,0 +1,209 @@
+/*
+ * softtimer.c
+ *
+ * Author: Michael Bossner
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "softtimer.h"
+#include "timer0.h"
+
+////////////////////////////// Global variables ///////////////////////////////
+
+// Flags only used in here. The low bits are the flags from softtimer.h.
+#define ACTIVE	0x10	// Counting down
+#define HELD	0x20	// Counting down is held (see softtimer_hold())
+#define QUEUED	0x40	// Deferred callback waiting in the queue
+
+typedef struct {
+	SoftTimerCallback callback;
+	const char* name;
+	uint16_t period;
+	// Milliseconds until the timer fires
+	uint16_t remaining;
+	uint8_t priority;
+	volatile uint8_t flags;
+	// Number of runs (stops at 0xFFFF) and the time taken in 8us units
+	uint16_t runs;
+	uint32_t total;
+	uint16_t max;
+} SoftTimer;
+
+static SoftTimer timers[SOFTTIMER_MAX];
+static uint8_t num_timers;
+// Timer ids from highest to lowest priority. The interrupt handler goes
+// through the timers in this order.
+static uint8_t order[SOFTTIMER_MAX];
+
+// Deferred timers that have fired but not run yet. A timer is only ever in
+// the queue once (see QUEUED), so with one spare entry (head == tail means
+// empty) it can hold every timer and never overflows.
+#define QUEUE_SIZE (SOFTTIMER_MAX + 1)
+static volatile uint8_t queue[QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static uint8_t queue_tail;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+static void run_timer(SoftTimer* timer);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Adds a timer after any of the same or higher priority
+int8_t softtimer_add(SoftTimerCallback callback, uint16_t period,
+		uint8_t priority, uint8_t flags, const char* name) {
+	if(num_timers == SOFTTIMER_MAX || period == 0) {
+		return -1;
+	}
+	uint8_t id;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		id = num_timers++;
+		SoftTimer* timer = &timers[id];
+		timer->callback = callback;
+		timer->name = name;
+		timer->period = period;
+		timer->remaining = period;
+		timer->priority = priority;
+		timer->flags = flags;
+		if(!(flags & SOFTTIMER_ONESHOT)) {
+			timer->flags |= ACTIVE;
+		}
+
+		uint8_t i = id;
+		while(i > 0 && timers[order[i-1]].priority < priority) {
+			order[i] = order[i-1];
+			i--;
+		}
+		order[i] = id;
+	}
+	return id;
+}
+
+void softtimer_start(int8_t id, uint16_t delay) {
+	if(id < 0) {
+		return;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		timers[id].remaining = delay ? delay : 1;
+		timers[id].flags |= ACTIVE;
+	}
+}
+
+void softtimer_stop(int8_t id) {
+	if(id < 0) {
+		return;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		timers[id].flags &= ~ACTIVE;
+	}
+}
+
+void softtimer_hold(int8_t id, uint8_t set) {
+	if(id < 0) {
+		return;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(set) {
+			timers[id].flags |= HELD;
+		} else {
+			timers[id].flags &= ~HELD;
+		}
+	}
+}
+
+// Runs everything in the deferred queue. A timer is taken out of the queue
+// before it runs so it can be queued again while it is running.
+void softtimer_run_deferred(void) {
+	while(queue_tail != queue_head) {
+		uint8_t id = queue[queue_tail];
+		queue_tail = (queue_tail + 1) % QUEUE_SIZE;
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			timers[id].flags &= ~QUEUED;
+		}
+		run_timer(&timers[id]);
+	}
+}
+
+uint8_t softtimer_count(void) {
+	return num_timers;
+}
+
+// The figures of timers run by the interrupt handler can change while they
+// are copied so interrupts are turned off
+void softtimer_get_stats(uint8_t index, SoftTimerStats* stats) {
+	SoftTimer* timer = &timers[order[index]];
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		stats->name = timer->name;
+		stats->period = timer->period;
+		stats->flags = timer->flags & (SOFTTIMER_ONESHOT | SOFTTIMER_DEFERRED |
+				SOFTTIMER_GAME_CLOCK);
+		stats->runs = timer->runs;
+		stats->average = timer->runs ? timer->total / timer->runs : 0;
+		stats->max = timer->max;
+	}
+}
+
+void softtimer_clear_stats(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for(uint8_t id = 0; id < num_timers; id++) {
+			timers[id].runs = 0;
+			timers[id].total = 0;
+			timers[id].max = 0;
+		}
+	}
+}
+
+// Called from the timer 0 interrupt handler every millisecond
+void softtimer_tick(uint8_t clock_paused) {
+	for(uint8_t i = 0; i < num_timers; i++) {
+		uint8_t id = order[i];
+		SoftTimer* timer = &timers[id];
+		uint8_t flags = timer->flags;
+
+		if(!(flags & ACTIVE) || (flags & HELD) ||
+				((flags & SOFTTIMER_GAME_CLOCK) && clock_paused)) {
+			continue;
+		}
+		if(--timer->remaining) {
+			continue;
+		}
+		if(flags & SOFTTIMER_ONESHOT) {
+			timer->flags &= ~ACTIVE;
+		} else {
+			timer->remaining = timer->period;
+		}
+
+		if(!(flags & SOFTTIMER_DEFERRED)) {
+			run_timer(timer);
+		} else if(!(flags & QUEUED)) {
+			timer->flags |= QUEUED;
+			queue[queue_head] = id;
+			queue_head = (queue_head + 1) % QUEUE_SIZE;
+		}
+	}
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Runs a timer's callback and records how long it took. Deferred callbacks
+// can be interrupted by the timers run from the interrupt handler so their
+// times include any interrupts that happened.
+static void run_timer(SoftTimer* timer) {
+	uint16_t start = get_fine_time();
+	timer->callback();
+	uint16_t elapsed = get_fine_time() - start;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(timer->runs != 0xFFFF) {
+			timer->runs++;
+			timer->total += elapsed;
+		}
+		if(elapsed > timer->max) {
+			timer->max = elapsed;
+		}
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * softtimer.h
+ *
+ * Soft timers run from the 1ms timer 0 interrupt. Each module registers the
+ * callbacks it needs rather than owning a hardware timer of its own.
+ * Callbacks run in the interrupt handler in priority order unless they are
+ * deferred, in which case they are queued and run from the main loop by
+ * softtimer_run_deferred(). The time each callback takes is recorded so it
+ * can be shown on the console.
+ *
+ * Author: Michael Bossner
+ */
+
+#ifndef SOFTTIMER_H_
+#define SOFTTIMER_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+// Maximum number of soft timers that can be registered. Six are used, the
+// rest are spare.
+#define SOFTTIMER_MAX 8
+
+// Timer flags (see softtimer_add())
+// Stops after firing once. Use softtimer_start() to fire it again.
+#define SOFTTIMER_ONESHOT		0x01
+// Runs from the main loop instead of the interrupt handler
+#define SOFTTIMER_DEFERRED		0x02
+// Doesn't count down while the game clock is paused (see pause_timer())
+#define SOFTTIMER_GAME_CLOCK	0x04
+
+// Priorities. Timers that are due in the same tick run highest first.
+#define SOFTTIMER_PRIORITY_LOW		0
+#define SOFTTIMER_PRIORITY_NORMAL	1
+#define SOFTTIMER_PRIORITY_HIGH		2
+
+typedef void (*SoftTimerCallback)(void);
+
+typedef struct {
+	const char* name;	// In program memory
+	uint16_t period;
+	uint8_t flags;
+	uint16_t runs;
+	uint16_t average;
+	uint16_t max;
+} SoftTimerStats;
+
+/*
+ * Registers a timer that calls callback every period ms. name is a string in
+ * program memory shown by the console. A periodic timer starts running
+ * straight away and a one-shot timer waits for softtimer_start(). Returns the
+ * timer id or -1 if there is no room.
+ */
+int8_t softtimer_add(SoftTimerCallback callback, uint16_t period,
+		uint8_t priority, uint8_t flags, const char* name);
+
+/*
+ * Starts (or restarts) a timer so that it fires in delay ms (at least 1).
+ */
+void softtimer_start(int8_t id, uint16_t delay);
+
+/*
+ * Stops a timer. A deferred callback that is already queued still runs.
+ */
+void softtimer_stop(int8_t id);
+
+/*
+ * Holds a timer (set=1) or lets it carry on (set=0). The time left until it
+ * fires is kept while it is held.
+ */
+void softtimer_hold(int8_t id, uint8_t set);
+
+/*
+ * Runs the deferred callbacks that are due. Called from the main loop and
+ * by idle() so that they also run while waiting outside the game.
+ */
+void softtimer_run_deferred(void);
+
+/*
+ * Returns the number of timers registered
+ */
+uint8_t softtimer_count(void);
+
+/*
+ * Gets the figures for a timer. index is from 0 to softtimer_count()-1 in
+ * priority order. Times are in 8us units (see get_fine_time()).
+ */
+void softtimer_get_stats(uint8_t index, SoftTimerStats* stats);
+
+/*
+ * Clears the run counts and times of every timer
+ */
+void softtimer_clear_stats(void);
+
+/*
+ * Counts down the timers and runs the ones that are due. Called every
+ * millisecond from the timer 0 interrupt handler. clock_paused is set while
+ * the game clock is paused.
+ */
+void softtimer_tick(uint8_t clock_paused);
+
+#endif /* SOFTTIMER_H_ */
@@ -0,0 +1,84 @@
+/*
+* status.c
+*
+* Author: Michael Bossner
+*/
+
+#include <avr/pgmspace.h>
+
+#include "status.h"
+#include "terminalio.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Where each channel is drawn on the status line and the width its value is
+// right aligned in. Values that can shrink need to be wide enough to cover
+// the old value.
+typedef struct {
+	uint8_t x;
+	uint8_t width;
+	const char* label;
+} StatusLayout;
+
+static const char score_label[] PROGMEM = "Score: ";
+static const char lives_label[] PROGMEM = "Lives: ";
+static const char level_label[] PROGMEM = "Level: ";
+static const char time_label[] PROGMEM = "Time: ";
+
+static const StatusLayout layout[NUM_STATUS_CHANNELS] PROGMEM = {
+	[STATUS_SCORE] = { 1, 4, score_label },
+	[STATUS_LIVES] = { 15, 1, lives_label },
+	[STATUS_LEVEL] = { 30, 1, level_label },
+	[STATUS_TIME] = { 60, 2, time_label }
+};
+
+// Value last drawn for each channel
+static uint32_t values[NUM_STATUS_CHANNELS];
+// Bit set for each channel that has been drawn since init_status()
+static uint8_t drawn;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+
+static void draw_channel(uint8_t channel);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Forgets the drawn values
+void init_status(void) {
+	drawn = 0;
+}
+
+// Draws the channel into the screen model if its value has changed
+void status_set(uint8_t channel, uint32_t value) {
+	if((drawn & (1<<channel)) && values[channel] == value) {
+		return;
+	}
+	values[channel] = value;
+	drawn |= (1<<channel);
+	draw_channel(channel);
+}
+
+// Draws every channel that has a value again
+void status_redraw(void) {
+	for(uint8_t channel = 0; channel < NUM_STATUS_CHANNELS; channel++) {
+		if(drawn & (1<<channel)) {
+			draw_channel(channel);
+		}
+	}
+}
+
+// Sends what fits of the status line
+void status_update(void) {
+	screen_flush();
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Draws a channel's label and value into the screen model
+static void draw_channel(uint8_t channel) {
+	uint8_t x = pgm_read_byte(&layout[channel].x);
+	const char* label = (const char*)pgm_read_word(&layout[channel].label);
+	screen_move(x, 1);
+	screen_put_string_P(label);
+	screen_put_unsigned(values[channel], pgm_read_byte(&layout[channel].width));
+}
@@ -0,0 +1,49 @@
+/*
+* status.h
+*
+* Status channels shown on the top line of the terminal (score, lives, level
+* and time left). Each channel holds a single number and only its newest
+* value is kept. Values are drawn into the terminal screen model and sent
+* whenever the serial output buffer has room, so setting a value never waits
+* for the terminal.
+*
+*Author: Michael Bossner
+*/
+
+#ifndef STATUS_H_
+#define STATUS_H_
+
+#include <stdint.h>
+
+typedef enum {
+	STATUS_SCORE,
+	STATUS_LIVES,
+	STATUS_LEVEL,
+	STATUS_TIME,
+	NUM_STATUS_CHANNELS
+} StatusChannel;
+
+/*
+ * Forgets the values last set so every channel is drawn again. Must be called
+ * after the terminal is cleared.
+ */
+void init_status(void);
+
+/*
+ * Sets the value of a channel. Nothing is redrawn if the value hasn't changed.
+ */
+void status_set(uint8_t channel, uint32_t value);
+
+/*
+ * Draws every channel again with the value it was last set to, e.g. after the
+ * terminal has been cleared without the game restarting.
+ */
+void status_redraw(void);
+
+/*
+ * Sends as much of the changed status line as the serial output buffer has
+ * room for. Called every time through the game loop.
+ */
+void status_update(void);
+
+#endif /* STATUS_H_ */
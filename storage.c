@@ -0,0 +1,158 @@
+/*
+ * storage.c
+ *
+ * Author: Michael Bossner
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+
+#include "storage.h"
+#include "idle.h"
+
+////////////////////////////// Global variables ///////////////////////////////
+
+typedef struct {
+	uint8_t* dest;
+	const uint8_t* source;
+	uint8_t length;
+	// Number of bytes written (or skipped as they were the same)
+	uint8_t done;
+	StorageCallback callback;
+} Write;
+
+// Queue of writes. The interrupt handler works on queue[tail] and takes
+// writes off the queue. Only the main program adds them.
+static Write queue[STORAGE_QUEUE_SIZE];
+static uint8_t head;
+static volatile uint8_t tail;
+static volatile uint8_t count;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+static void write_next(void);
+static void wait_for_write(void);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+void storage_write(void* dest, const void* source, uint8_t length,
+		StorageCallback callback) {
+	if(length == 0) {
+		return;
+	}
+	while(count == STORAGE_QUEUE_SIZE) {
+		wait_for_write();
+	}
+
+	Write* write = &queue[head];
+	write->dest = dest;
+	write->source = source;
+	write->length = length;
+	write->done = 0;
+	write->callback = callback;
+	head = (head + 1) % STORAGE_QUEUE_SIZE;
+
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	count++;
+	// The interrupt fires straight away if the EEPROM is ready
+	EECR |= (1<<EERIE);
+	if(interrupts_were_enabled) {
+		sei();
+	}
+}
+
+// The EEPROM can't be read while a byte is being written, so the interrupt
+// is turned off (so it can't start another one) and the last byte is waited
+// for. Then the queued bytes are copied over what was read, oldest first.
+void storage_read(void* dest, const void* source, uint8_t length) {
+	uint8_t interrupts_were_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	EECR &= ~(1<<EERIE);
+	if(interrupts_were_enabled) {
+		sei();
+	}
+	eeprom_read_block(dest, source, length);
+
+	uint8_t index = tail;
+	for(uint8_t i = 0; i < count; i++) {
+		Write* write = &queue[index];
+		for(uint8_t j = 0; j < write->length; j++) {
+			uint16_t offset = (uint16_t)(write->dest + j) -
+					(uint16_t)source;
+			if(offset < length) {
+				((uint8_t*)dest)[offset] = write->source[j];
+			}
+		}
+		index = (index + 1) % STORAGE_QUEUE_SIZE;
+	}
+
+	cli();
+	if(count) {
+		EECR |= (1<<EERIE);
+	}
+	if(interrupts_were_enabled) {
+		sei();
+	}
+}
+
+uint8_t storage_busy(void) {
+	return count != 0;
+}
+
+void storage_flush(void) {
+	while(count) {
+		wait_for_write();
+	}
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Waits for the next byte to be written. If interrupts are off (e.g. while
+// starting up) the bytes are written from here instead of the interrupt
+// handler.
+static void wait_for_write(void) {
+	if(bit_is_set(SREG, SREG_I)) {
+		idle();
+	} else if(eeprom_is_ready()) {
+		write_next();
+	}
+}
+
+// Starts writing the next byte that needs changing. A write is taken off
+// the queue (and its callback called) once all its bytes are done and the
+// EEPROM is ready again. Called with interrupts off.
+static void write_next(void) {
+	while(count) {
+		Write* write = &queue[tail];
+		if(write->done == write->length) {
+			StorageCallback callback = write->callback;
+			tail = (tail + 1) % STORAGE_QUEUE_SIZE;
+			count--;
+			if(callback) {
+				callback();
+			}
+			continue;
+		}
+
+		uint8_t byte = write->source[write->done];
+		EEAR = (uint16_t)(write->dest + write->done);
+		write->done++;
+		EECR |= (1<<EERE);
+		if(EEDR != byte) {
+			EEDR = byte;
+			// EEPE must be set within 4 cycles of EEMPE
+			EECR |= (1<<EEMPE);
+			EECR |= (1<<EEPE);
+			return;
+		}
+	}
+	// Nothing left to write
+	EECR &= ~(1<<EERIE);
+}
+
+// Called whenever the EEPROM is ready while there are writes queued
+ISR(EE_READY_vect) {
+	idle_woken_by(IDLE_WAKE_EEPROM);
+	write_next();
+}
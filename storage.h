@@ -0,0 +1,51 @@
+/*
+ * storage.h
+ *
+ * Writes to the EEPROM in the background. Writing a byte takes about 3.3ms
+ * so rather than waiting for each one, writes are queued and the EEPROM
+ * ready interrupt writes the next byte as soon as the last one is done.
+ * Everything that uses the EEPROM must go through here (see storage_read())
+ * so that nothing touches the EEPROM while the interrupt handler is using it.
+ *
+ * Author: Michael Bossner
+ */
+
+#ifndef STORAGE_H_
+#define STORAGE_H_
+
+#include <stdint.h>
+
+// Number of writes that can be waiting at once
+#define STORAGE_QUEUE_SIZE 8
+
+typedef void (*StorageCallback)(void);
+
+/*
+ * Queues a write of length bytes from source (in RAM) to dest in EEPROM.
+ * The bytes are read from source as they are written so source must stay
+ * in place until the write is done. Bytes that already hold the right value
+ * aren't written. If callback isn't 0 it is called from the interrupt
+ * handler once the last byte has been written so it should be short (e.g.
+ * set a flag). Sleeps until there is room if the queue is full.
+ */
+void storage_write(void* dest, const void* source, uint8_t length,
+		StorageCallback callback);
+
+/*
+ * Reads length bytes from source in EEPROM to dest. Writes that are still
+ * queued are included so the result is what the EEPROM will hold.
+ */
+void storage_read(void* dest, const void* source, uint8_t length);
+
+/*
+ * Returns non-zero while there are writes that haven't finished
+ */
+uint8_t storage_busy(void);
+
+/*
+ * Waits until every queued write has finished. Must be called before
+ * anything that resets the processor or turns interrupts off for good.
+ */
+void storage_flush(void);
+
+#endif /* STORAGE_H_ */
@@ -0,0 +1,114 @@
+/*
+* telemetry.c
+*
+* Author: Michael Bossner
+*/
+
+#include "telemetry.h"
+#include "serialio.h"
+#include "timer0.h"
+#include "game.h"
+#include "score.h"
+#include "life.h"
+#include "level.h"
+#include "countdown.h"
+#include "latency.h"
+
+////////////////////////////// Global variables ////////////////////////////////
+
+// Payload lengths (type and time included)
+#define STATE_LENGTH 20
+#define INPUT_LENGTH 9
+#define STATS_LENGTH 21
+
+static uint32_t last_state;
+static uint32_t last_stats;
+
+/////////////////// Function Prototypes for Helper Functions ///////////////////
+
+static uint8_t begin_record(uint8_t type, uint8_t length);
+static void put_u16(uint16_t value);
+static void put_u32(uint32_t value);
+
+/////////////////////////////// Public Functions ///////////////////////////////
+
+// Sends the periodic records
+void telemetry_update(void) {
+	if(!serial_telemetry()) {
+		return;
+	}
+	uint32_t now = get_loop_time();
+	if(now - last_state >= TELEMETRY_PERIOD &&
+			begin_record(TELEMETRY_STATE, STATE_LENGTH)) {
+		last_state = now;
+		serial_frame_byte(get_frog_row());
+		serial_frame_byte(get_frog_column());
+		for(uint8_t lane = 0; lane < 3; lane++) {
+			serial_frame_byte(get_lane_position(lane));
+		}
+		for(uint8_t channel = 0; channel < 2; channel++) {
+			serial_frame_byte(get_log_position(channel));
+		}
+		put_u32(get_score());
+		serial_frame_byte(get_lives());
+		serial_frame_byte(get_level());
+		put_u16(get_countdown());
+		serial_frame_end();
+	}
+	if(now - last_stats >= TELEMETRY_STATS_PERIOD &&
+			begin_record(TELEMETRY_STATS, STATS_LENGTH)) {
+		SerialStats serial;
+		LatencyStats latency;
+		last_stats = now;
+		serial_get_stats(&serial);
+		latency_get_stats(&latency);
+		put_u16(serial.rx_dropped);
+		put_u16(serial.tx_stalls);
+		put_u16(serial.rx_peak);
+		put_u16(serial.tx_peak);
+		put_u16(latency.samples);
+		put_u16(latency.min);
+		put_u16(latency.average);
+		put_u16(latency.max);
+		serial_frame_end();
+	}
+}
+
+// Sends an input record
+void telemetry_input(uint8_t key, uint8_t action, uint16_t stamp) {
+	if(!serial_telemetry() || !begin_record(TELEMETRY_INPUT, INPUT_LENGTH)) {
+		return;
+	}
+	serial_frame_byte(key);
+	serial_frame_byte(action);
+	put_u16(stamp);
+	serial_frame_end();
+}
+
+// Switches between telemetry and the terminal
+void telemetry_toggle(void) {
+	serial_set_telemetry(!serial_telemetry());
+}
+
+/////////////////////////////// Private (Helper) Functions /////////////////////
+
+// Starts a frame with the record type and time. Returns 0 if there isn't
+// room for it.
+static uint8_t begin_record(uint8_t type, uint8_t length) {
+	if(!serial_frame_begin(length)) {
+		return 0;
+	}
+	serial_frame_byte(type);
+	put_u32(get_current_time());
+	return 1;
+}
+
+static void put_u16(uint16_t value) {
+	serial_frame_byte(value & 0xFF);
+	serial_frame_byte(value >> 8);
+}
+
+static void put_u32(uint32_t value) {
+	put_u16(value & 0xFFFF);
+	put_u16(value >> 16);
+}
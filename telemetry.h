@@ -0,0 +1,51 @@
+/*
+* telemetry.h
+*
+* Binary telemetry for logging games without parsing the terminal screens.
+* While the serial port is in telemetry mode (see serial_set_telemetry())
+* records describing the game are sent as COBS framed binary records instead
+* of the terminal UI. tools/telemetry_decode.py turns them into CSV.
+*
+* Every record starts with its type and the time in ms (uint32). Multi byte
+* values are little endian.
+*	TELEMETRY_STATE (every TELEMETRY_PERIOD ms):
+*		frog row, frog column, 3 lane positions, 2 log positions (uint8),
+*		score (uint32), lives, level (uint8), countdown in 10ms (uint16)
+*	TELEMETRY_INPUT (for every input acted on):
+*		keycode, action (uint8), fine time stamp of the input (uint16)
+*	TELEMETRY_STATS (every TELEMETRY_STATS_PERIOD ms):
+*		serial rx dropped, tx stalls, rx peak, tx peak (uint16),
+*		latency samples, min, average, max in 8us units (uint16)
+*
+*Author: Michael Bossner
+*/
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+#define TELEMETRY_STATE 1
+#define TELEMETRY_INPUT 2
+#define TELEMETRY_STATS 3
+
+#define TELEMETRY_PERIOD 100
+#define TELEMETRY_STATS_PERIOD 1000
+
+/*
+ * Sends the state and stats records when they are due. Called every time
+ * through the game loop. Does nothing unless in telemetry mode.
+ */
+void telemetry_update(void);
+
+/*
+ * Sends an input record.
+ */
+void telemetry_input(uint8_t key, uint8_t action, uint16_t stamp);
+
+/*
+ * Switches the serial port between telemetry and the terminal UI.
+ */
+void telemetry_toggle(void);
+
+#endif /* TELEMETRY_H_ */
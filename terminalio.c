@@ -1,86 +1,351 @@
-/*
- * terminalio.c
- *
- * Author: Peter Sutton
- */
-
-#include <stdio.h>
-#include <stdint.h>
-
-#include <avr/pgmspace.h>
-
-#include "terminalio.h"
-
-void move_cursor(int x, int y) {
-    printf_P(PSTR("\x1b[%d;%dH"), y, x);
-}
-
-void normal_display_mode(void) {
-	printf_P(PSTR("\x1b[0m"));
-}
-
-void reverse_video(void) {
-	printf_P(PSTR("\x1b[7m"));
-}
-
-void clear_terminal(void) {
-	printf_P(PSTR("\x1b[2J"));
-}
-
-void clear_to_end_of_line(void) {
-	printf_P(PSTR("\x1b[K"));
-}
-
-void set_display_attribute(DisplayParameter parameter) {
-	printf_P(PSTR("\x1b[%dm"), parameter);
-}
-
-void hide_cursor() {
-	printf_P(PSTR("\x1b[?25l"));
-}
-
-void show_cursor() {
-	printf_P(PSTR("\x1b[?25h"));
-}
-
-void enable_scrolling_for_whole_display(void) {
-	printf_P(PSTR("\x1b[r"));
-}
-
-void set_scroll_region(int8_t y1, int8_t y2) {
-	printf_P(PSTR("\x1b[%d;%dr"), y1, y2);
-}
-
-void scroll_down(void) {
-	printf_P(PSTR("\x1bM"));	// ESC-M
-}
-
-void scroll_up(void) {
-	printf_P(PSTR("\x1b\x44"));	// ESC-D
-}
-
-void draw_horizontal_line(int8_t y, int8_t start_x, int8_t end_x) {
-	int8_t i;
-	move_cursor(start_x, y);
-	reverse_video();
-	for(i=start_x; i <= end_x; i++) {
-		printf(" ");	/* No need to use printf_P - printing 
-						 * a single character gets optimised
-						 * to a putchar call 
-						 */
-	}
-	normal_display_mode();
-}
-
-void draw_vertical_line(int8_t x, int8_t start_y, int8_t end_y) {
-	int8_t i;
-	move_cursor(x, start_y);
-	reverse_video();
-	for(i=start_y; i < end_y; i++) {
-		printf(" ");
-		/* Move down one and back to the left one */
-		printf_P(PSTR("\x1b[B\x1b[D"));
-	}
-	printf(" ");
-	normal_display_mode();
-}
+/*
+ * terminalio.c
+ *
+ * Author: Peter Sutton
+ */
+
+#include <stdint.h>
+
+#include <avr/pgmspace.h>
+
+#include "terminalio.h"
+#include "serialio.h"
+
+/* Escape sequences are written straight to the serial output buffer rather
+ * than through printf. Numbers are converted by repeated subtraction of
+ * powers of ten, which avoids both the format parsing and 32 bit division.
+ * Each sequence is built whole and written with serial_write_all() so that
+ * when the output buffer is full it is dropped rather than cut short (which
+ * would leave the terminal in the middle of a sequence).
+ */
+#define ESCAPE_CHAR 27
+/* Longest sequence built: ESC [ 65535 ; 65535 final */
+#define MAX_SEQUENCE 14
+static const uint32_t powers_of_ten[] PROGMEM = {
+	1000000000, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1
+};
+#define MAX_DIGITS 10
+
+/* Attribute last sent to the terminal (as far as we know) */
+static uint8_t current_attribute = TERM_RESET;
+
+/* The screen model. screen_chars and screen_attributes hold what should be
+ * shown and a bit is set in screen_dirty for each cell the terminal isn't
+ * showing yet. screen_changed is set if any bit is. */
+static char screen_chars[SCREEN_ROWS][SCREEN_COLS];
+static uint8_t screen_attributes[SCREEN_ROWS][SCREEN_COLS];
+static uint8_t screen_dirty[SCREEN_ROWS][SCREEN_COLS/8];
+static uint8_t screen_changed;
+/* Where the next character written to the model goes (0 based) and its
+ * attribute */
+static int screen_x;
+static int screen_y;
+static uint8_t screen_pen = TERM_RESET;
+
+/* Skipping a gap shorter than this is done by resending the characters in
+ * it rather than with a cursor move (which is at least 4 bytes) */
+#define SCREEN_MIN_SKIP 4
+/* Output buffer space screen_flush() needs before sending a cell: the
+ * longest cursor move (8), attribute (7) and gap (3) plus the cell itself
+ * and the attribute put back at the end (7) */
+#define SCREEN_CELL_RESERVE 26
+
+static void blank_screen(void);
+static void send_attribute(uint8_t attribute);
+static uint8_t format_unsigned(char* digits, uint32_t value);
+static uint8_t put_sequence_P(const char* sequence);
+static uint8_t put_csi(char final);
+static uint8_t put_csi_1(uint16_t parameter, char final);
+static uint8_t put_csi_2(uint16_t parameter1, uint16_t parameter2, char final);
+
+void move_cursor(int x, int y) {
+	put_csi_2(y, x, 'H');
+}
+
+/* The attribute is only remembered if the terminal was sent it */
+void normal_display_mode(void) {
+	if(put_csi_1(TERM_RESET, 'm')) {
+		current_attribute = TERM_RESET;
+	}
+}
+
+void reverse_video(void) {
+	if(put_csi_1(TERM_REVERSE, 'm')) {
+		current_attribute = TERM_REVERSE;
+	}
+}
+
+void clear_terminal(void) {
+	put_csi_1(2, 'J');
+	blank_screen();
+}
+
+void clear_to_end_of_line(void) {
+	put_csi('K');
+}
+
+void clear_report_area(void) {
+	move_cursor(1, REPORT_FIRST_ROW);
+	/* Erase from the cursor to the end of the screen */
+	put_csi('J');
+}
+
+void set_display_attribute(DisplayParameter parameter) {
+	if(put_csi_1(parameter, 'm')) {
+		current_attribute = parameter;
+	}
+}
+
+uint8_t get_display_attribute(void) {
+	return current_attribute;
+}
+
+void hide_cursor() {
+	put_sequence_P(PSTR("\x1b[?25l"));
+}
+
+void show_cursor() {
+	put_sequence_P(PSTR("\x1b[?25h"));
+}
+
+void enable_scrolling_for_whole_display(void) {
+	put_csi('r');
+}
+
+void set_scroll_region(int8_t y1, int8_t y2) {
+	put_csi_2(y1, y2, 'r');
+}
+
+void scroll_down(void) {
+	put_sequence_P(PSTR("\x1b" "M"));	// ESC-M
+}
+
+void scroll_up(void) {
+	put_sequence_P(PSTR("\x1b" "D"));	// ESC-D
+}
+
+void term_put_unsigned(uint32_t value, uint8_t width) {
+	char digits[MAX_DIGITS];
+	uint8_t length = format_unsigned(digits, value);
+	while(width > length) {
+		serial_put_char(' ');
+		width--;
+	}
+	for(uint8_t i = 0; i < length; i++) {
+		serial_put_char(digits[i]);
+	}
+}
+
+void term_put_string_P(const char* string) {
+	serial_put_string_P(string);
+}
+
+void term_put_string(const char* string) {
+	while(*string) {
+		serial_put_char(*string++);
+	}
+}
+
+void draw_horizontal_line(int8_t y, int8_t start_x, int8_t end_x) {
+	int8_t i;
+	move_cursor(start_x, y);
+	reverse_video();
+	for(i=start_x; i <= end_x; i++) {
+		serial_put_char(' ');
+	}
+	normal_display_mode();
+}
+
+void draw_vertical_line(int8_t x, int8_t start_y, int8_t end_y) {
+	int8_t i;
+	move_cursor(x, start_y);
+	reverse_video();
+	for(i=start_y; i < end_y; i++) {
+		serial_put_char(' ');
+		/* Move down one and back to the left one */
+		put_sequence_P(PSTR("\x1b[B\x1b[D"));
+	}
+	serial_put_char(' ');
+	normal_display_mode();
+}
+
+void screen_set_attribute(DisplayParameter parameter) {
+	screen_pen = parameter;
+}
+
+void screen_move(int x, int y) {
+	screen_x = x - 1;
+	screen_y = y - SCREEN_FIRST_ROW;
+}
+
+void screen_put_char(char c) {
+	if(screen_y >= 0 && screen_y < SCREEN_ROWS &&
+			screen_x >= 0 && screen_x < SCREEN_COLS) {
+		/* Only cells that actually change need sending */
+		if(screen_chars[screen_y][screen_x] != c ||
+				screen_attributes[screen_y][screen_x] != screen_pen) {
+			screen_chars[screen_y][screen_x] = c;
+			screen_attributes[screen_y][screen_x] = screen_pen;
+			screen_dirty[screen_y][screen_x/8] |= (1 << (screen_x%8));
+			screen_changed = 1;
+		}
+	}
+	screen_x++;
+}
+
+void screen_put_unsigned(uint32_t value, uint8_t width) {
+	char digits[MAX_DIGITS];
+	uint8_t length = format_unsigned(digits, value);
+	while(width > length) {
+		screen_put_char(' ');
+		width--;
+	}
+	for(uint8_t i = 0; i < length; i++) {
+		screen_put_char(digits[i]);
+	}
+}
+
+void screen_put_string_P(const char* string) {
+	char c;
+	while((c = pgm_read_byte(string++)) != 0) {
+		screen_put_char(c);
+	}
+}
+
+void screen_flush(void) {
+	if(!screen_changed) {
+		return;
+	}
+	/* Put the attribute back afterwards so output that doesn't go through
+	 * the model isn't affected */
+	uint8_t saved_attribute = current_attribute;
+	uint8_t finished = 1;
+	for(int8_t y = 0; y < SCREEN_ROWS && finished; y++) {
+		/* Column the terminal cursor is at or -1 if it isn't on this row */
+		int8_t cursor_x = -1;
+		for(int8_t x = 0; x < SCREEN_COLS; x++) {
+			if(!(screen_dirty[y][x/8] & (1 << (x%8)))) {
+				continue;
+			}
+			/* Never wait for the terminal. What is left stays dirty and
+			 * goes next time, by when the cells may have changed again. */
+			if(serial_tx_free() < SCREEN_CELL_RESERVE) {
+				finished = 0;
+				break;
+			}
+			/* Get the cursor to the changed cell. Short gaps of unchanged
+			 * cells in the current attribute are cheaper to resend. */
+			if(cursor_x < 0) {
+				move_cursor(x + 1, y + SCREEN_FIRST_ROW);
+			} else if(x != cursor_x) {
+				int8_t resend = (x - cursor_x < SCREEN_MIN_SKIP);
+				for(int8_t i = cursor_x; i < x && resend; i++) {
+					resend = (screen_attributes[y][i] == current_attribute);
+				}
+				if(resend) {
+					for(int8_t i = cursor_x; i < x; i++) {
+						serial_put_char(screen_chars[y][i]);
+					}
+				} else {
+					put_csi_1(x - cursor_x, 'C');
+				}
+			}
+			if(screen_attributes[y][x] != current_attribute) {
+				send_attribute(screen_attributes[y][x]);
+			}
+			serial_put_char(screen_chars[y][x]);
+			screen_dirty[y][x/8] &= ~(1 << (x%8));
+			cursor_x = x + 1;
+		}
+	}
+	if(current_attribute != saved_attribute) {
+		send_attribute(saved_attribute);
+	}
+	screen_changed = !finished;
+}
+
+/* Set the screen model to what the terminal shows once it has been cleared */
+static void blank_screen(void) {
+	for(uint8_t y = 0; y < SCREEN_ROWS; y++) {
+		for(uint8_t x = 0; x < SCREEN_COLS; x++) {
+			screen_chars[y][x] = ' ';
+			screen_attributes[y][x] = TERM_RESET;
+		}
+		for(uint8_t i = 0; i < SCREEN_COLS/8; i++) {
+			screen_dirty[y][i] = 0;
+		}
+	}
+	screen_changed = 0;
+}
+
+/* Send a single sequence that sets the given attribute and nothing else */
+static void send_attribute(uint8_t attribute) {
+	uint8_t sent;
+	if(attribute == TERM_RESET) {
+		sent = put_csi_1(TERM_RESET, 'm');
+	} else {
+		sent = put_csi_2(TERM_RESET, attribute, 'm');
+	}
+	if(sent) {
+		current_attribute = attribute;
+	}
+}
+
+/* Convert value to decimal digits (without a terminator) and return how
+ * many there are. Leading zeros are dropped but at least one digit is
+ * always produced. */
+static uint8_t format_unsigned(char* digits, uint32_t value) {
+	uint8_t length = 0;
+	for(uint8_t i = 0; i < MAX_DIGITS; i++) {
+		uint32_t power = pgm_read_dword(&powers_of_ten[i]);
+		char digit = '0';
+		while(value >= power) {
+			value -= power;
+			digit++;
+		}
+		if(digit != '0' || length > 0 || i == MAX_DIGITS - 1) {
+			digits[length++] = digit;
+		}
+	}
+	return length;
+}
+
+/* Send a whole sequence stored in program memory. Like the put_csi
+ * functions below it returns non-zero if the sequence was sent (see
+ * serial_write_all()). */
+static uint8_t put_sequence_P(const char* sequence) {
+	char buffer[MAX_SEQUENCE];
+	uint8_t length = 0;
+	while((buffer[length] = pgm_read_byte(sequence++)) != 0) {
+		length++;
+	}
+	return serial_write_all(buffer, length);
+}
+
+/* Send ESC [ <final> */
+static uint8_t put_csi(char final) {
+	char sequence[3] = { ESCAPE_CHAR, '[', final };
+	return serial_write_all(sequence, sizeof(sequence));
+}
+
+/* Send ESC [ <parameter> <final> */
+static uint8_t put_csi_1(uint16_t parameter, char final) {
+	char sequence[MAX_SEQUENCE];
+	sequence[0] = ESCAPE_CHAR;
+	sequence[1] = '[';
+	uint8_t length = 2 + format_unsigned(&sequence[2], parameter);
+	sequence[length++] = final;
+	return serial_write_all(sequence, length);
+}
+
+/* Send ESC [ <parameter1> ; <parameter2> <final> */
+static uint8_t put_csi_2(uint16_t parameter1, uint16_t parameter2, char final) {
+	char sequence[MAX_SEQUENCE];
+	sequence[0] = ESCAPE_CHAR;
+	sequence[1] = '[';
+	uint8_t length = 2 + format_unsigned(&sequence[2], parameter1);
+	sequence[length++] = ';';
+	length += format_unsigned(&sequence[length], parameter2);
+	sequence[length++] = final;
+	return serial_write_all(sequence, length);
+}
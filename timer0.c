@@ -1,92 +1,172 @@
-/*
- * timer0.c
- *
- * Author: Peter Sutton
- *
- * We setup timer0 to generate an interrupt every 1ms
- * We update a global clock tick variable - whose value
- * can be retrieved using the get_clock_ticks() function.
- */
-
-#include <avr/io.h>
-#include <avr/interrupt.h>
-
-#include "timer0.h"
-
-/* Our internal clock tick count - incremented every
- * millisecond. Will overflow every ~49 days. */
-static volatile uint32_t clockTicks;
-
-uint8_t pause;
-
-/* Set up timer 0 to generate an interrupt every 1ms.
- * We will divide the clock by 64 and count up to 124.
- * We will therefore get an interrupt every 64 x 125
- * clock cycles, i.e. every 1 milliseconds with an 8MHz
- * clock.
- * The counter will be reset to 0 when it reaches it's
- * output compare value.
- */
-void init_timer0(void) {
-	/* Reset clock tick count. L indicates a long (32 bit)
-	 * constant.
-	 */
-	clockTicks = 0L;
-
-	pause = 0;
-
-	/* Clear the timer */
-	TCNT0 = 0;
-
-	/* Set the output compare value to be 124 */
-	OCR0A = 124;
-
-	/* Set the timer to clear on compare match (CTC mode)
-	 * and to divide the clock by 64. This starts the timer
-	 * running.
-	 */
-	TCCR0A = (1<<WGM01);
-	TCCR0B = (1<<CS01)|(1<<CS00);
-
-	/* Enable an interrupt on output compare match.
-	 * Note that interrupts have to be enabled globally
-	 * before the interrupts will fire.
-	 */
-	TIMSK0 |= (1<<OCIE0A);
-
-	/* Make sure the interrupt flag is cleared by writing a
-	 * 1 to it.
-	 */
-	TIFR0 &= (1<<OCF0A);
-}
-
-uint32_t get_current_time(void) {
-	uint32_t returnValue;
-
-	/* Disable interrupts so we can be sure that the interrupt
-	 * doesn't fire when we've copied just a couple of bytes
-	 * of the value. Interrupts are re-enabled if they were
-	 * enabled at the start.
-	 */
-	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
-	cli();
-	returnValue = clockTicks;
-	if(interruptsOn) {
-		sei();
-	}
-	return returnValue;
-}
-
-void pause_timer(uint8_t set) {
-	pause = set;
-	if(!pause) {
-		TIFR0 &= (1<<OCF0A);
-	}
-}
-
-ISR(TIMER0_COMPA_vect) {
-	/* Increment our clock tick count */
-	if(!pause) {
-		clockTicks++;
-	}
-}
+/*
+ * timer0.c
+ *
+ * Author: Peter Sutton
+ *
+ * We setup timer0 to generate an interrupt every 1ms
+ * We update a global clock tick variable - whose value
+ * can be retrieved using the get_clock_ticks() function.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "timer0.h"
+#include "softtimer.h"
+#include "idle.h"
+
+/* Our internal clock tick count - incremented every millisecond, even
+ * while paused. Will overflow every ~49 days. Also used for fine time
+ * stamps. */
+static volatile uint32_t freeTicks;
+
+/* Clock tick value latched at the start of each pass through the main
+ * loop (see update_loop_time()) */
+static uint32_t loopTicks;
+
+uint8_t pause;
+/* The clock returned by get_current_time() is freeTicks less the time it
+ * has spent paused. While paused it stays at the tick it was paused on. */
+static uint32_t paused_ticks;
+static uint32_t paused_at;
+
+/* Set up timer 0 to generate an interrupt every 1ms.
+ * We will divide the clock by 64 and count up to 124.
+ * We will therefore get an interrupt every 64 x 125
+ * clock cycles, i.e. every 1 milliseconds with an 8MHz
+ * clock.
+ * The counter will be reset to 0 when it reaches it's
+ * output compare value.
+ */
+void init_timer0(void) {
+	/* Reset clock tick count. L indicates a long (32 bit)
+	 * constant.
+	 */
+	freeTicks = 0L;
+	paused_ticks = 0;
+
+	pause = 0;
+
+	/* Clear the timer */
+	TCNT0 = 0;
+
+	/* Set the output compare value to be 124 */
+	OCR0A = 124;
+
+	/* Set the timer to clear on compare match (CTC mode)
+	 * and to divide the clock by 64. This starts the timer
+	 * running.
+	 */
+	TCCR0A = (1<<WGM01);
+	TCCR0B = (1<<CS01)|(1<<CS00);
+
+	/* Enable an interrupt on output compare match.
+	 * Note that interrupts have to be enabled globally
+	 * before the interrupts will fire.
+	 */
+	TIMSK0 |= (1<<OCIE0A);
+
+	/* Make sure the interrupt flag is cleared by writing a
+	 * 1 to it.
+	 */
+	TIFR0 &= (1<<OCF0A);
+}
+
+uint32_t get_current_time(void) {
+	uint32_t returnValue;
+
+	/* The interrupt could fire when we've copied just a couple of bytes
+	 * of the value. Rather than turning interrupts off we read it again
+	 * until two reads agree - the interrupt only fires once a
+	 * millisecond so the second read is almost never needed.
+	 */
+	do {
+		returnValue = freeTicks;
+	} while(returnValue != freeTicks);
+	/* paused_at and paused_ticks only change with interrupts off (see
+	 * pause_timer()) so they can't change part way through */
+	if(pause) {
+		returnValue = paused_at;
+	}
+	return returnValue - paused_ticks;
+}
+
+uint16_t get_ticks16(void) {
+	return get_current_time();
+}
+
+uint16_t ticks_since(uint16_t then) {
+	return get_ticks16() - then;
+}
+
+void update_loop_time(void) {
+	loopTicks = get_current_time();
+}
+
+uint32_t get_loop_time(void) {
+	return loopTicks;
+}
+
+uint16_t get_fine_time(void) {
+	uint16_t ticks;
+	uint8_t count;
+	uint8_t pending;
+
+	/* Read again if the interrupt ran part way through (see
+	 * get_current_time()) */
+	do {
+		ticks = freeTicks;
+		count = TCNT0;
+		pending = (TIFR0 & (1<<OCF0A)) && count < 62;
+	} while(ticks != (uint16_t)freeTicks);
+	/* If the counter has just been cleared but the interrupt hasn't run
+	 * yet (interrupts are off) then the millisecond count is one behind. */
+	if(pending) {
+		ticks++;
+	}
+	/* 125 timer counts per millisecond. Differences between two stamps
+	 * are correct modulo 2^16 so wrapping doesn't matter. */
+	return ticks*125 + count;
+}
+
+uint32_t get_fine_time32(void) {
+	uint32_t ticks;
+	uint8_t count;
+	uint8_t pending;
+
+	/* The same as get_fine_time() with all 32 bits of the count */
+	do {
+		ticks = freeTicks;
+		count = TCNT0;
+		pending = (TIFR0 & (1<<OCF0A)) && count < 62;
+	} while(ticks != freeTicks);
+	if(pending) {
+		ticks++;
+	}
+	return ticks*125 + count;
+}
+
+void pause_timer(uint8_t set) {
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	/* Only the clock is frozen. The timer itself keeps running so the
+	 * fine time and the soft timers carry on undisturbed. */
+	if(set && !pause) {
+		paused_at = freeTicks;
+	} else if(!set && pause) {
+		paused_ticks += freeTicks - paused_at;
+	}
+	pause = set;
+	if(interruptsOn) {
+		sei();
+	}
+}
+
+ISR(TIMER0_COMPA_vect) {
+	/* Increment our clock tick count */
+	freeTicks++;
+	idle_woken_by(IDLE_WAKE_TIMER);
+	/* Everything else that runs off the 1ms tick (the buttons, audio and
+	 * countdown) is registered as a soft timer */
+	softtimer_tick(pause);
+}
@@ -1,34 +1,73 @@
-/*
- * timer0.h
- *
- * Author: Peter Sutton
- *
- * We set up timer 0 to give us an interrupt
- * every millisecond. Tasks that have to occur
- * regularly (every millisecond or few) can be added
- * to the interrupt handler (in timer0.c) or can
- * be added to the main event loop that checks the
- * clock tick value. This value (32 bits) can be
- * obtained using the get_clock_ticks() function.
- * (Any tasks undertaken in the interrupt handler
- * should be kept short so that we don't run the
- * risk of missing an interrupt in future.)
- */
-
-#ifndef TIMER0_H_
-#define TIMER0_H_
-
-#include <stdint.h>
-
-/* Set up our timer to give us an interrupt every millisecond
- * and update our time reference.
- */
-void init_timer0(void);
-
-/* Return the current clock tick value - milliseconds since the timer was
- * initialised.
- */
-uint32_t get_current_time(void);
-void pause_timer(uint8_t set);
-
+/*
+ * timer0.h
+ *
+ * Author: Peter Sutton
+ *
+ * We set up timer 0 to give us an interrupt
+ * every millisecond. Tasks that have to occur
+ * regularly (every millisecond or few) can be added
+ * to the interrupt handler (in timer0.c) or can
+ * be added to the main event loop that checks the
+ * clock tick value. This value (32 bits) can be
+ * obtained using the get_clock_ticks() function.
+ * (Any tasks undertaken in the interrupt handler
+ * should be kept short so that we don't run the
+ * risk of missing an interrupt in future.)
+ */
+
+#ifndef TIMER0_H_
+#define TIMER0_H_
+
+#include <stdint.h>
+
+/* Set up our timer to give us an interrupt every millisecond
+ * and update our time reference.
+ */
+void init_timer0(void);
+
+/* Return the current clock tick value - milliseconds since the timer was
+ * initialised. Doesn't turn interrupts off so it is cheap to call.
+ */
+uint32_t get_current_time(void);
+
+/* Return the low 16 bits of get_current_time(). Enough for timing anything
+ * shorter than a minute (see ticks_since()).
+ */
+uint16_t get_ticks16(void);
+
+/* Return the milliseconds since a time returned by get_ticks16(). Correct
+ * across the 16 bit value wrapping for intervals of up to 65535ms.
+ */
+uint16_t ticks_since(uint16_t then);
+
+/* Latch the current time for this pass through the main loop. Called once
+ * at the start of each pass of the play_game() loop.
+ */
+void update_loop_time(void);
+
+/* Return the time latched by update_loop_time(). Code run from the
+ * play_game() loop uses this so that everything in one pass sees the same
+ * time and the clock isn't read over and over.
+ */
+uint32_t get_loop_time(void);
+
+/* Return a fine time stamp in units of 8us (one timer count). The stamp
+ * wraps every ~524ms so it is only useful for measuring short intervals
+ * (the difference of two stamps). Keeps counting while paused.
+ */
+uint16_t get_fine_time(void);
+
+/* Return the full 32 bit fine time (8us units), which wraps every ~9.5
+ * hours. Used to stamp inputs, which can wait longer than get_fine_time()
+ * can measure (e.g. while a level change is shown).
+ */
+uint32_t get_fine_time32(void);
+
+/* Stop (set=1) or restart (set=0) the clock returned by get_current_time().
+ * The time spent paused is taken off the clock. The timer itself is left
+ * running, so the fine time and the soft timers aren't disturbed. The clock
+ * can gain or lose up to 1ms across each pause, about as often either way.
+ */
+void pause_timer(uint8_t set);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Upload a bank of level patterns to the game's EEPROM (see levelbank.h).
+
+The levels are read from a JSON file holding a list of up to 8 patterns:
+
+    [
+        {
+            "lanes": ["0b1100...", "0b0011...", "0b0000..."],
+            "logs": ["0b1111...", "0b1110..."],
+            "colours": ["red", "yellow", "red"],
+            "speeds": [1000, 1300, 865, 1225, 1150],
+            "riverbank": "0b1101110111011101"
+        },
+        ...
+    ]
+
+lanes are 64 bit and logs 32 bit patterns (1 = vehicle/log). colours are
+names or LED matrix colour values. speeds are the ms between moves of each
+row at level 1, sped up like the built in speeds on later levels (0 or
+missing keeps the speed the game would use). riverbank has a 1 for bank and
+a 0 for each hole, bit 0 is the left column. It needs at least one of each. Numbers may be written
+as integers or "0b"/"0x" strings.
+
+Pause the game, type "upload" at the console then run e.g.
+    python3 level_upload.py levels.json --port /dev/ttyUSB0 --baud 19200
+Uploading needs pyserial. --output writes the frames to a file instead.
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+BANK_SIZE = 8
+DEFAULT_RIVERBANK = 0b1101110111011101
+# LevelData in level.h: lanes, logs, colours, speeds, riverbank
+LEVEL_FORMAT = "<3Q2I3B5HH"
+COLOURS = {
+    "black": 0x00, "red": 0x0F, "green": 0xF0, "yellow": 0xDF,
+    "orange": 0x3C, "light_orange": 0x13, "light_yellow": 0x35,
+    "light_green": 0x11,
+}
+REPLY = re.compile(rb"Upload (OK|ERR) (.)")
+
+
+def crc8(data):
+    """CRC-8 with polynomial 0x07 and initial value 0 (as avr-libc's
+    _crc8_ccitt_update)."""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def cobs_encode(data):
+    """COBS encode data and add the zero delimiter."""
+    out = bytearray()
+    block = bytearray()
+    for byte in data:
+        if byte == 0:
+            out += bytes([len(block) + 1]) + block
+            block = bytearray()
+        else:
+            block.append(byte)
+            if len(block) == 0xFE:
+                out += b"\xff" + block
+                block = bytearray()
+    out += bytes([len(block) + 1]) + block
+    out.append(0)
+    return bytes(out)
+
+
+def frame(payload):
+    """Add the CRC to a payload and COBS encode it."""
+    return cobs_encode(payload + bytes([crc8(payload)]))
+
+
+def number(value):
+    if isinstance(value, str):
+        return int(value, 0)
+    return int(value)
+
+
+def colour(value):
+    if isinstance(value, str) and value.lower() in COLOURS:
+        return COLOURS[value.lower()]
+    return number(value)
+
+
+def pack_level(level):
+    lanes = [number(v) for v in level["lanes"]]
+    logs = [number(v) for v in level["logs"]]
+    colours = [colour(v) for v in level["colours"]]
+    speeds = [number(v) for v in level.get("speeds", [0] * 5)]
+    riverbank = number(level.get("riverbank", DEFAULT_RIVERBANK))
+    if len(lanes) != 3 or len(logs) != 2 or len(colours) != 3 or \
+            len(speeds) != 5:
+        raise ValueError("need 3 lanes, 2 logs, 3 colours and 5 speeds")
+    if riverbank & 0xFFFF in (0, 0xFFFF):
+        raise ValueError("riverbank needs at least one hole and one bank")
+    return struct.pack(LEVEL_FORMAT, *lanes, *logs, *colours, *speeds,
+                       riverbank)
+
+
+def upload_frames(levels):
+    """Yield the frames of an upload in order."""
+    yield frame(b"B" + bytes([len(levels)]))
+    for index, level in enumerate(levels):
+        yield frame(b"L" + bytes([index]) + pack_level(level))
+    yield frame(b"E")
+
+
+def send(port, data, timeout):
+    """Send a frame and wait for its answer. Returns True if accepted."""
+    port.reset_input_buffer()
+    port.write(data)
+    received = b""
+    port.timeout = timeout
+    while True:
+        chunk = port.read(64)
+        if not chunk:
+            return False
+        received += chunk
+        match = REPLY.search(received)
+        if match:
+            return match.group(1) == b"OK"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("levels", help="JSON file of patterns")
+    parser.add_argument("--port", help="serial port the game is on")
+    parser.add_argument("--baud", type=int, default=19200)
+    parser.add_argument("--timeout", type=float, default=2.0,
+                        help="seconds to wait for each answer")
+    parser.add_argument("--output",
+                        help="write the frames to this file instead")
+    args = parser.parse_args()
+
+    with open(args.levels) as f:
+        levels = json.load(f)
+    if not 1 <= len(levels) <= BANK_SIZE:
+        sys.exit("need 1 to %d patterns" % BANK_SIZE)
+    frames = list(upload_frames(levels))
+
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(b"".join(frames))
+        return
+    if not args.port:
+        sys.exit("give --port or --output")
+
+    import serial
+    with serial.Serial(args.port, args.baud) as port:
+        for number_sent, data in enumerate(frames):
+            if not send(port, data, args.timeout):
+                sys.exit("frame %d was not accepted" % number_sent)
+    print("Uploaded %d patterns" % len(levels), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
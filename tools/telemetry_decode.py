@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Decode the binary telemetry stream sent in telemetry mode (see
+telemetry.h) into CSV.
+
+Reads the raw serial stream from a file (or stdin) and writes one CSV file
+per record type: <prefix>_state.csv, <prefix>_input.csv and
+<prefix>_stats.csv. Frames that fail the CRC check are counted and skipped.
+
+Capture the stream with e.g.
+    stty -F /dev/ttyUSB0 19200 raw && cat /dev/ttyUSB0 > game.bin
+then
+    python3 telemetry_decode.py game.bin --prefix game
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+# Record type -> (name, struct format after the type byte, field names)
+RECORDS = {
+    1: ("state", "<IBBBBBBBIBBH",
+        ["time_ms", "frog_row", "frog_column", "lane0", "lane1", "lane2",
+         "log0", "log1", "score", "lives", "level", "countdown_10ms"]),
+    2: ("input", "<IBBH",
+        ["time_ms", "keycode", "action", "stamp_8us"]),
+    3: ("stats", "<IHHHHHHHH",
+        ["time_ms", "rx_dropped", "tx_stalls", "rx_peak", "tx_peak",
+         "latency_samples", "latency_min_8us", "latency_avg_8us",
+         "latency_max_8us"]),
+}
+
+
+def crc8(data):
+    """CRC-8 with polynomial 0x07 and initial value 0 (as avr-libc's
+    _crc8_ccitt_update)."""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def cobs_decode(frame):
+    """Decode one COBS frame (without its zero delimiter). Returns None if
+    the frame is malformed."""
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            return None
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(stream):
+    """Yield the zero delimited frames in a byte stream."""
+    pending = bytearray()
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            break
+        pending += chunk
+        while True:
+            end = pending.find(0)
+            if end < 0:
+                break
+            if end > 0:
+                yield bytes(pending[:end])
+            del pending[:end + 1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", nargs="?", default="-",
+                        help="captured stream (default stdin)")
+    parser.add_argument("--prefix", default="telemetry",
+                        help="prefix of the CSV files written")
+    args = parser.parse_args()
+
+    stream = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+    files = {}
+    writers = {}
+    for name, _, fields in RECORDS.values():
+        files[name] = open("%s_%s.csv" % (args.prefix, name), "w", newline="")
+        writers[name] = csv.writer(files[name])
+        writers[name].writerow(fields)
+
+    counts = {name: 0 for name, _, _ in RECORDS.values()}
+    bad = 0
+    for frame in frames(stream):
+        data = cobs_decode(frame)
+        if data is None or len(data) < 2 or crc8(data[:-1]) != data[-1]:
+            bad += 1
+            continue
+        record = RECORDS.get(data[0])
+        if record is None or len(data) - 2 != struct.calcsize(record[1]):
+            bad += 1
+            continue
+        name, layout, _ = record
+        writers[name].writerow(struct.unpack(layout, data[1:-1]))
+        counts[name] += 1
+
+    for f in files.values():
+        f.close()
+    summary = ", ".join("%d %s" % (counts[n], n) for n in counts)
+    print("%s records, %d bad frames" % (summary, bad), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()